@@ -20,10 +20,12 @@
 
 #include <linux/skbuff.h>
 #include <linux/win_minmax.h>
+#include <linux/welford.h>
 #include <net/sock.h>
 #include <net/inet_connection_sock.h>
 #include <net/inet_timewait_sock.h>
 #include <uapi/linux/tcp.h>
+#include <uapi/linux/tcp_cubic.h>
 
 static inline struct tcphdr *tcp_hdr(const struct sk_buff *skb)
 {
@@ -55,6 +57,17 @@ static inline unsigned int tcp_optlen(const struct sk_buff *skb)
 	return (tcp_hdr(skb)->doff - 5) * 4;
 }
 
+/* struct tcp_cubic_hystart of uapi/linux/tcp_cubic.h, as kept by
+ * tcp_sock and tcp_cubic
+ */
+struct tcp_cubic_policy {
+	u8	set:1,		/* TCP_CUBIC_HYSTART is in effect */
+		detect:7;
+	u8	low_window;
+	u8	ack_delta_ms;
+	u8	delay_max_ms;
+};
+
 /* TCP Fast Open */
 #define TCP_FASTOPEN_COOKIE_MIN	4	/* Min Fast Open Cookie size in bytes */
 #define TCP_FASTOPEN_COOKIE_MAX	16	/* Max Fast Open Cookie size in bytes */
@@ -219,7 +232,9 @@ struct tcp_sock {
 	} rack;
 	u16	advmss;		/* Advertised MSS			*/
 	u8	tlp_retrans:1,	/* TLP is a retransmission */
-		unused_1:7;
+		sdev_frozen:1,	/* congestion control stopped sdev_stats */
+		sdev_ewma_shift:5, /* sdev_stats EWMA gain 2^-n, 0: cumulative */
+		rtt_samples:1;	/* feed sdev_stats every per-skb RTT */
 	u32	chrono_start;	/* Start time in jiffies of a TCP chrono */
 	u32	chrono_stat[3];	/* Time in jiffies for chrono_stat stats */
 	u8	chrono_type:2,	/* current chronograph type */
@@ -253,13 +268,6 @@ struct tcp_sock {
 	u32	rtt_seq;	/* sequence number to update rttvar	*/
 	struct  minmax rtt_min;
 
-	/* ***CHANGE*** */
-	struct sdev{
-		long num_packets; /* number of packets received to update variance (may be duplicate of rtt_seq) */
-		long mean_rtt_us; /* current mean rtt in msec */
-		long long m2_rtt_ms;   /* aggregates the squared distance from the mean in ms */
-	} sdev_stats;
-
 	u32	packets_out;	/* Packets which are "in flight"	*/
 	u32	retrans_out;	/* Retransmitted packets out		*/
 	u32	max_packets_out;  /* max packets_out in last window */
@@ -382,6 +390,15 @@ struct tcp_sock {
 	 */
 	struct request_sock *fastopen_rsk;
 	u32	*saved_syn;
+
+/* HyStart and tcp_cubic state, after every other member so that the
+ * fields above keep their offsets and the ACK path its cachelines.
+ * sdev_stats is only written while the congestion control samples.
+ */
+	struct welford sdev_stats; /* RTT mean/variance, fed by CUBIC */
+	u32	pacing_cap;	/* CA cap on sk_pacing_rate (bytes/sec), 0: none */
+	struct tcp_cubic_policy cubic_hystart; /* TCP_CUBIC_HYSTART */
+	u8	cubic_found;	/* TCP_CUBIC_HYSTART_* that ended slow start */
 };
 
 enum tsq_enum {
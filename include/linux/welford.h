@@ -0,0 +1,219 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * Running mean and variance of a stream of usec samples using Welford's
+ * online algorithm, in integer fixed point.
+ *
+ * The mean is kept in usec << WELFORD_SHIFT so that small deltas still
+ * move it, and M2 (the sum of squared distances from the mean) is kept
+ * in usec^2 and saturates instead of wrapping.  Updating costs one 32-bit
+ * divide; the 64-bit M2 / count divide is left to welford_var(), which
+ * callers should only invoke where the variance is actually consumed.
+ *
+ * welford_merge() combines two accumulators in constant time (Chan et
+ * al.), which also lets one ACK that covers k packets be folded in as a
+ * single batch of k samples instead of k separate updates.  It too stays
+ * within one 32-bit divide, see welford_scale().
+ */
+#ifndef WELFORD_H
+#define WELFORD_H
+
+#include <linux/kernel.h>
+#include <linux/math64.h>
+#include <linux/types.h>
+
+#define WELFORD_SHIFT		8
+/* Largest sample that still fits a signed 32-bit fixed-point delta */
+#define WELFORD_VALUE_MAX	((u32)S32_MAX >> WELFORD_SHIFT)
+#define WELFORD_COUNT_MAX	((u32)S32_MAX)
+
+struct welford {
+	u32	count;	/* number of samples, saturates at WELFORD_COUNT_MAX */
+	u32	mean;	/* running mean, usec << WELFORD_SHIFT */
+	u64	m2;	/* sum of squared distances from the mean, usec^2 */
+};
+
+static inline void welford_reset(struct welford *w)
+{
+	w->count = 0;
+	w->mean = 0;
+	w->m2 = 0;
+}
+
+static inline bool welford_saturated(const struct welford *w)
+{
+	return w->m2 == U64_MAX;
+}
+
+static inline u64 welford_add_sat(u64 a, u64 b)
+{
+	u64 sum = a + b;
+
+	return unlikely(sum < a) ? U64_MAX : sum;
+}
+
+/* Fold one sample (usec) into the running statistics */
+static inline void welford_update(struct welford *w, u32 sample_us)
+{
+	s32 x, delta;
+	u32 n, mag, step;
+
+	x = min_t(u32, sample_us, WELFORD_VALUE_MAX) << WELFORD_SHIFT;
+	if (likely(w->count < WELFORD_COUNT_MAX))
+		w->count++;
+	n = w->count;
+
+	/* Round to nearest so the mean does not drift towards zero.  The
+	 * magnitude is taken unsigned: |delta| <= S32_MAX and n / 2 < 2^30,
+	 * so their sum fits a u32 even when a multi-second sample meets a
+	 * small mean.
+	 */
+	delta = x - (s32)w->mean;
+	mag = delta >= 0 ? delta : -(u32)delta;
+	step = (mag + n / 2) / n;
+	w->mean += delta >= 0 ? step : -step;
+
+	/* delta and (x - new mean) share a sign, so the product is >= 0 */
+	w->m2 = welford_add_sat(w->m2,
+				((s64)delta * (x - (s32)w->mean)) >>
+				(2 * WELFORD_SHIFT));
+}
+
+static inline u64 welford_mul_sat(u64 a, u32 b)
+{
+	return unlikely(fls64(a) + fls(b) > 64) ? U64_MAX : a * b;
+}
+
+/* mag * k / n, rounded, for k <= n and without a 64-bit divide.  When
+ * the product fits it is one 32-bit divide; otherwise k / n is taken as
+ * a Q16 reciprocal weight, itself a 32-bit divide, and multiplied in,
+ * which is within mag / 2^14 of the exact step.
+ */
+static inline u32 welford_scale(u32 mag, u32 k, u32 n)
+{
+	u32 s, frac;
+
+	if (fls(mag) + fls(k) <= 31)
+		return (mag * k + n / 2) / n;
+
+	s = fls(k) > 16 ? fls(k) - 16 : 0;
+	frac = ((k >> s) << 16) / (n >> s);
+	return ((u64)mag * frac + (1U << 15)) >> 16;
+}
+
+/* Fold the statistics of b into w */
+static inline void welford_merge(struct welford *w, const struct welford *b)
+{
+	u32 n, mag, step;
+	s32 delta;
+	u64 m2;
+
+	if (!b->count)
+		return;
+	if (!w->count) {
+		*w = *b;
+		return;
+	}
+
+	n = min_t(u64, (u64)w->count + b->count, WELFORD_COUNT_MAX);
+	delta = (s32)b->mean - (s32)w->mean;
+	mag = delta >= 0 ? delta : -(u32)delta;
+	step = welford_scale(mag, b->count, n);
+	w->mean += delta >= 0 ? step : -step;
+
+	/* delta * (b.mean - new mean) * b.count == delta^2 * na * nb / n */
+	m2 = ((s64)delta * ((s32)b->mean - (s32)w->mean)) >>
+	     (2 * WELFORD_SHIFT);
+	w->m2 = welford_add_sat(welford_add_sat(w->m2, b->m2),
+				welford_mul_sat(m2, b->count));
+	w->count = n;
+}
+
+/* Fold in k samples that all measured sample_us */
+static inline void welford_update_n(struct welford *w, u32 sample_us,
+				    u32 k)
+{
+	struct welford b = {
+		.count	= k,
+		.mean	= min_t(u32, sample_us, WELFORD_VALUE_MAX) <<
+			  WELFORD_SHIFT,
+		.m2	= 0,
+	};
+
+	if (k <= 1)
+		welford_update(w, sample_us);
+	else
+		welford_merge(w, &b);
+}
+
+/* Exponentially weighted variant.  Once count reaches 2^shift it stays
+ * there and every update first decays M2 by 1/2^shift, which turns the
+ * mean and variance into EWMAs with gain 1/2^shift and the divides into
+ * shifts.  A shift of 0 is the plain cumulative update.
+ */
+static inline void welford_update_ewma(struct welford *w, u32 sample_us,
+				       u8 shift)
+{
+	s32 x, delta;
+
+	if (!shift || w->count < (1U << shift)) {
+		welford_update(w, sample_us);
+		return;
+	}
+
+	x = min_t(u32, sample_us, WELFORD_VALUE_MAX) << WELFORD_SHIFT;
+	delta = x - (s32)w->mean;
+	w->mean += (delta + (1 << (shift - 1))) >> shift;
+	/* saturation is sticky, as in welford_update(): do not decay it */
+	if (unlikely(welford_saturated(w)))
+		return;
+	w->m2 -= w->m2 >> shift;
+	w->m2 = welford_add_sat(w->m2,
+				((s64)delta * (x - (s32)w->mean)) >>
+				(2 * WELFORD_SHIFT));
+}
+
+/* Batched form of welford_update_ewma(): k samples of sample_us move
+ * the estimate as one sample with gain k/2^shift, capped at one half.
+ */
+static inline void welford_update_ewma_n(struct welford *w, u32 sample_us,
+					 u32 k, u8 shift)
+{
+	s32 x, delta;
+	u32 g;
+
+	if (!shift || w->count < (1U << shift)) {
+		welford_update_n(w, sample_us, k);
+		/* Overshooting 2^shift: rescale M2 to the pinned count */
+		if (shift && w->count > (1U << shift)) {
+			if (w->m2 != U64_MAX)
+				w->m2 = div_u64(w->m2, w->count) << shift;
+			w->count = 1U << shift;
+		}
+		return;
+	}
+
+	g = clamp_t(u32, k, 1, 1U << (shift - 1));
+	x = min_t(u32, sample_us, WELFORD_VALUE_MAX) << WELFORD_SHIFT;
+	delta = x - (s32)w->mean;
+	w->mean += ((s64)delta * g + (1 << (shift - 1))) >> shift;
+	if (unlikely(welford_saturated(w)))
+		return;
+	w->m2 -= (w->m2 >> shift) * g;
+	w->m2 = welford_add_sat(w->m2,
+				welford_mul_sat(((s64)delta *
+						 (x - (s32)w->mean)) >>
+						(2 * WELFORD_SHIFT), g));
+}
+
+static inline u32 welford_mean(const struct welford *w)
+{
+	return (w->mean + (1U << (WELFORD_SHIFT - 1))) >> WELFORD_SHIFT;
+}
+
+/* Population variance in usec^2.  Costs a 64-bit divide. */
+static inline u64 welford_var(const struct welford *w)
+{
+	return w->count ? div_u64(w->m2, w->count) : 0;
+}
+
+#endif
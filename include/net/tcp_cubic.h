@@ -0,0 +1,62 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * Pluggable HyStart exit predicate for TCP CUBIC, and the record of its
+ * slow start flight recorder.
+ *
+ * A module registers one cubic_hystart_ops; while bit 0x20 is set in
+ * tcp_cubic's hystart_detect parameter, CUBIC asks it at each of the
+ * delay checkpoints of a slow start round (once HYSTART_MIN_SAMPLES
+ * delays are in, then each time the round's sample count doubles)
+ * whether to leave slow start.  The context is a snapshot and may not
+ * be written through.  The built-in rules decide whenever the predicate
+ * returns CUBIC_HYSTART_DEFAULT or none is registered.
+ */
+#ifndef _NET_TCP_CUBIC_H
+#define _NET_TCP_CUBIC_H
+
+#include <linux/types.h>
+
+struct sock;
+
+struct cubic_hystart_ctx {
+	const struct sock *sk;
+	u32	delay_us;	/* RTT sample of this ACK */
+	u32	curr_rtt_us;	/* minimum RTT of the round's first
+				 * samples, or its percentile RTT */
+	u32	delay_min_us;	/* minimum RTT seen */
+	u32	mean_us;	/* Welford mean of the RTT samples */
+	u64	var_us2;	/* Welford variance, usec^2 */
+	u32	sample_cnt;	/* RTT samples so far this round */
+	u32	round_us;	/* time since the round started */
+	u32	snd_cwnd;
+	u32	rate_delivered;	/* last rate sample: packets delivered */
+	u32	rate_interval_us; /* last rate sample: time elapsed */
+};
+
+enum {
+	CUBIC_HYSTART_DEFAULT,	/* let the built-in rules decide */
+	CUBIC_HYSTART_CONTINUE,	/* stay in slow start, skip the built-ins */
+	CUBIC_HYSTART_EXIT,	/* leave slow start now */
+};
+
+struct cubic_hystart_ops {
+	int	(*exit)(const struct cubic_hystart_ctx *ctx);
+	char	name[16];
+};
+
+int cubic_hystart_register(struct cubic_hystart_ops *ops);
+void cubic_hystart_unregister(struct cubic_hystart_ops *ops);
+
+/* One ACK of the slow start flight recorder, as the tcp_cubic:cubic_ss
+ * tracepoint hands it out once slow start is over.
+ */
+struct cubic_ss_sample {
+	u32	t_us;		/* since the first recorded ACK */
+	u32	rtt_us;
+	u32	mean_us;	/* Welford mean of the RTT samples */
+	u32	sdev_us;	/* Welford deviation of the RTT samples */
+	u32	snd_cwnd;
+	u32	delivered;	/* tp->delivered */
+};
+
+#endif
@@ -0,0 +1,280 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM tcp_cubic
+
+#if !defined(_TRACE_TCP_CUBIC_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _TRACE_TCP_CUBIC_H
+
+#include <linux/tracepoint.h>
+#include <net/inet_sock.h>
+#include <net/tcp.h>
+#include <net/tcp_cubic.h>
+
+/*
+ * One fixed-size binary record per RTT sample seen by CUBIC.
+ *
+ * Records land in the per-CPU ftrace ring buffer, so nothing here takes a
+ * lock or formats a string on the ACK path; formatting only happens when
+ * the "trace" file is read.  Collectors that want the raw records can
+ * splice or mmap per_cpu/cpuN/trace_pipe_raw instead.
+ */
+TRACE_EVENT(cubic_acked,
+
+	TP_PROTO(const struct sock *sk, s32 rtt_us, u32 pkts_acked,
+		 u64 variance, u32 sdev),
+
+	TP_ARGS(sk, rtt_us, pkts_acked, variance, sdev),
+
+	TP_STRUCT__entry(
+		__field(const void *, skaddr)
+		__field(__u16, sport)
+		__field(__u16, dport)
+		__field(__u8, in_slow_start)
+		__field(__u8, m2_saturated)
+		__field(__s32, rtt_us)
+		__field(__u32, mean_rtt_us)
+		__field(__u32, sdev_us)
+		__field(__u32, count)
+		__field(__u64, variance)
+		__field(__u64, m2)
+		__field(__u32, snd_cwnd)
+		__field(__u32, snd_ssthresh)
+		__field(__u32, pkts_acked)
+		__field(__u32, mss_cache)
+		__field(__u32, mdev_us)
+		__field(__u32, lost_out)
+		__field(__u32, retrans_out)
+		__field(__u32, sacked_out)
+		__field(__u32, packets_out)
+		__field(__u32, delivered)
+		__field(__u32, rate_delivered)
+		__field(__u64, bytes_acked)
+		__field(__u32, snd_nxt)
+		__field(__u32, snd_una)
+		__field(__u32, pushed_seq)
+	),
+
+	TP_fast_assign(
+		const struct inet_sock *inet = inet_sk(sk);
+		const struct tcp_sock *tp = tcp_sk(sk);
+
+		__entry->skaddr = sk;
+		__entry->sport = ntohs(inet->inet_sport);
+		__entry->dport = ntohs(inet->inet_dport);
+		__entry->in_slow_start = tcp_in_slow_start(tp);
+		__entry->rtt_us = rtt_us;
+		__entry->m2_saturated = welford_saturated(&tp->sdev_stats);
+		__entry->mean_rtt_us = welford_mean(&tp->sdev_stats);
+		__entry->sdev_us = sdev;
+		__entry->count = tp->sdev_stats.count;
+		__entry->variance = variance;
+		__entry->m2 = tp->sdev_stats.m2;
+		__entry->snd_cwnd = tp->snd_cwnd;
+		__entry->snd_ssthresh = tp->snd_ssthresh;
+		__entry->pkts_acked = pkts_acked;
+		__entry->mss_cache = tp->mss_cache;
+		__entry->mdev_us = tp->mdev_us;
+		__entry->lost_out = tp->lost_out;
+		__entry->retrans_out = tp->retrans_out;
+		__entry->sacked_out = tp->sacked_out;
+		__entry->packets_out = tp->packets_out;
+		__entry->delivered = tp->delivered;
+		__entry->rate_delivered = tp->rate_delivered;
+		__entry->bytes_acked = tp->bytes_acked;
+		__entry->snd_nxt = tp->snd_nxt;
+		__entry->snd_una = tp->snd_una;
+		__entry->pushed_seq = tp->pushed_seq;
+	),
+
+	TP_printk("sport=%hu dport=%hu ss=%u rtt_us=%d mean_us=%u var=%llu sdev_us=%u "
+		  "count=%u m2=%llu%s cwnd=%u ssthresh=%u pkts_acked=%u mss=%u "
+		  "mdev_us=%u lost=%u retrans=%u sacked=%u in_flight=%u "
+		  "delivered=%u rate_delivered=%u bytes_acked=%llu "
+		  "snd_nxt=%u snd_una=%u pushed_seq=%u",
+		  __entry->sport, __entry->dport, __entry->in_slow_start,
+		  __entry->rtt_us, __entry->mean_rtt_us, __entry->variance,
+		  __entry->sdev_us, __entry->count, __entry->m2,
+		  __entry->m2_saturated ? "(saturated)" : "",
+		  __entry->snd_cwnd, __entry->snd_ssthresh,
+		  __entry->pkts_acked, __entry->mss_cache, __entry->mdev_us,
+		  __entry->lost_out, __entry->retrans_out, __entry->sacked_out,
+		  __entry->packets_out, __entry->delivered,
+		  __entry->rate_delivered, __entry->bytes_acked,
+		  __entry->snd_nxt, __entry->snd_una, __entry->pushed_seq)
+);
+
+/* HyStart exit triggers, matching HYSTART_* in net/ipv4/tcp_cubic.c */
+#define show_hystart_trigger(trigger)					\
+	__print_flags(trigger, "|",					\
+		{ 0x1, "ACK_TRAIN" },					\
+		{ 0x2, "DELAY" },					\
+		{ 0x4, "DELAY_SDEV" },					\
+		{ 0x8, "RATE" },					\
+		{ 0x10, "SHARED" },					\
+		{ 0x20, "CUSTOM" })
+
+DECLARE_EVENT_CLASS(cubic_hystart_class,
+
+	TP_PROTO(const struct sock *sk, u32 trigger, u32 delay_min_us,
+		 u32 curr_rtt_us, u32 thresh_us),
+
+	TP_ARGS(sk, trigger, delay_min_us, curr_rtt_us, thresh_us),
+
+	TP_STRUCT__entry(
+		__field(const void *, skaddr)
+		__field(__u16, sport)
+		__field(__u16, dport)
+		__field(__u32, trigger)
+		__field(__u32, snd_cwnd)
+		__field(__u32, delay_min_us)
+		__field(__u32, curr_rtt_us)
+		__field(__u32, thresh_us)
+	),
+
+	TP_fast_assign(
+		const struct inet_sock *inet = inet_sk(sk);
+
+		__entry->skaddr = sk;
+		__entry->sport = ntohs(inet->inet_sport);
+		__entry->dport = ntohs(inet->inet_dport);
+		__entry->trigger = trigger;
+		__entry->snd_cwnd = tcp_sk(sk)->snd_cwnd;
+		__entry->delay_min_us = delay_min_us;
+		__entry->curr_rtt_us = curr_rtt_us;
+		__entry->thresh_us = thresh_us;
+	),
+
+	TP_printk("sport=%hu dport=%hu trigger=%s cwnd=%u delay_min_us=%u "
+		  "curr_rtt_us=%u thresh_us=%u",
+		  __entry->sport, __entry->dport,
+		  show_hystart_trigger(__entry->trigger), __entry->snd_cwnd,
+		  __entry->delay_min_us, __entry->curr_rtt_us,
+		  __entry->thresh_us)
+);
+
+/* A HyStart trigger fired and slow start is left at the current cwnd. */
+DEFINE_EVENT(cubic_hystart_class, cubic_hystart_exit,
+
+	TP_PROTO(const struct sock *sk, u32 trigger, u32 delay_min_us,
+		 u32 curr_rtt_us, u32 thresh_us),
+
+	TP_ARGS(sk, trigger, delay_min_us, curr_rtt_us, thresh_us)
+);
+
+/* The per-round delay sample is complete and is about to be compared
+ * against the exit threshold; fires at most once per round.
+ */
+DEFINE_EVENT(cubic_hystart_class, cubic_hystart_sample,
+
+	TP_PROTO(const struct sock *sk, u32 trigger, u32 delay_min_us,
+		 u32 curr_rtt_us, u32 thresh_us),
+
+	TP_ARGS(sk, trigger, delay_min_us, curr_rtt_us, thresh_us)
+);
+
+/* Why the slow start flight recorder was emitted, matching CUBIC_SS_* */
+#define show_cubic_ss_cause(cause)					\
+	__print_symbolic(cause,						\
+		{ 0, "EXIT" },						\
+		{ 1, "LOSS" },						\
+		{ 2, "SSTHRESH" },					\
+		{ 3, "CLOSE" })
+
+/*
+ * One record of a socket's slow start flight recorder.  The recorder is
+ * emitted once per connection, oldest ACK first, when HyStart exits, on
+ * the first loss, when cwnd reaches a preset ssthresh or when the socket
+ * goes away while still in slow start.  seq counts every ACK recorded;
+ * only the last CUBIC_SS_RING_SIZE of them are kept, so a gap between
+ * 0 and the first seq means the start of slow start was overwritten.
+ */
+TRACE_EVENT(cubic_ss,
+
+	TP_PROTO(const struct sock *sk, u32 cause, u32 seq, u32 count,
+		 const struct cubic_ss_sample *s),
+
+	TP_ARGS(sk, cause, seq, count, s),
+
+	TP_STRUCT__entry(
+		__field(const void *, skaddr)
+		__field(__u16, sport)
+		__field(__u16, dport)
+		__field(__u32, cause)
+		__field(__u32, seq)
+		__field(__u32, count)
+		__field(__u32, t_us)
+		__field(__u32, rtt_us)
+		__field(__u32, mean_us)
+		__field(__u32, sdev_us)
+		__field(__u32, snd_cwnd)
+		__field(__u32, delivered)
+	),
+
+	TP_fast_assign(
+		const struct inet_sock *inet = inet_sk(sk);
+
+		__entry->skaddr = sk;
+		__entry->sport = ntohs(inet->inet_sport);
+		__entry->dport = ntohs(inet->inet_dport);
+		__entry->cause = cause;
+		__entry->seq = seq;
+		__entry->count = count;
+		__entry->t_us = s->t_us;
+		__entry->rtt_us = s->rtt_us;
+		__entry->mean_us = s->mean_us;
+		__entry->sdev_us = s->sdev_us;
+		__entry->snd_cwnd = s->snd_cwnd;
+		__entry->delivered = s->delivered;
+	),
+
+	TP_printk("sport=%hu dport=%hu cause=%s seq=%u/%u t_us=%u rtt_us=%u "
+		  "mean_us=%u sdev_us=%u cwnd=%u delivered=%u",
+		  __entry->sport, __entry->dport,
+		  show_cubic_ss_cause(__entry->cause), __entry->seq,
+		  __entry->count, __entry->t_us, __entry->rtt_us,
+		  __entry->mean_us, __entry->sdev_us, __entry->snd_cwnd,
+		  __entry->delivered)
+);
+
+TRACE_EVENT(cubic_ssthresh_recalc,
+
+	TP_PROTO(const struct sock *sk, u32 last_max_cwnd, u32 ssthresh),
+
+	TP_ARGS(sk, last_max_cwnd, ssthresh),
+
+	TP_STRUCT__entry(
+		__field(const void *, skaddr)
+		__field(__u16, sport)
+		__field(__u16, dport)
+		__field(__u8, in_slow_start)
+		__field(__u32, snd_cwnd)
+		__field(__u32, prior_ssthresh)
+		__field(__u32, last_max_cwnd)
+		__field(__u32, ssthresh)
+	),
+
+	TP_fast_assign(
+		const struct inet_sock *inet = inet_sk(sk);
+		const struct tcp_sock *tp = tcp_sk(sk);
+
+		__entry->skaddr = sk;
+		__entry->sport = ntohs(inet->inet_sport);
+		__entry->dport = ntohs(inet->inet_dport);
+		__entry->in_slow_start = tcp_in_slow_start(tp);
+		__entry->snd_cwnd = tp->snd_cwnd;
+		__entry->prior_ssthresh = tp->snd_ssthresh;
+		__entry->last_max_cwnd = last_max_cwnd;
+		__entry->ssthresh = ssthresh;
+	),
+
+	TP_printk("sport=%hu dport=%hu ss=%u cwnd=%u prior_ssthresh=%u "
+		  "last_max_cwnd=%u ssthresh=%u",
+		  __entry->sport, __entry->dport, __entry->in_slow_start,
+		  __entry->snd_cwnd, __entry->prior_ssthresh,
+		  __entry->last_max_cwnd, __entry->ssthresh)
+);
+
+#endif /* _TRACE_TCP_CUBIC_H */
+
+/* This part must be outside protection */
+#include <trace/define_trace.h>
@@ -0,0 +1,89 @@
+/* SPDX-License-Identifier: GPL-2.0 WITH Linux-syscall-note */
+#ifndef _UAPI_LINUX_TCP_CUBIC_H
+#define _UAPI_LINUX_TCP_CUBIC_H
+
+#include <linux/types.h>
+
+/*
+ * tcp_cubic's socket options and attributes.  Their numbers are taken
+ * from the top of each space rather than after the last upstream one,
+ * which upstream keeps handing out in sequence: a tool built against
+ * newer headers must never read one of these as its own.
+ */
+
+/* getsockopt(SOL_TCP, TCP_CUBIC_INFO): the struct tcp_cubic_info of
+ * the socket, truncated to optlen like TCP_INFO.  0 bytes unless the
+ * socket runs one of the cubic congestion controls.
+ */
+#define TCP_CUBIC_INFO		0x4300
+
+/* setsockopt(SOL_TCP, TCP_CUBIC_HYSTART): a struct tcp_cubic_hystart
+ * HyStart policy for tcp_cubic.  It overrides the hystart_detect,
+ * hystart_low_window, hystart_ack_delta and hystart_delay_max module
+ * parameters for connections established after it is set, including
+ * the children of a listener.  An optlen of 0 drops the override;
+ * getsockopt returns 0 bytes while none is set.
+ */
+#define TCP_CUBIC_HYSTART	0x4301
+
+/* INET_DIAG attribute carrying struct tcp_cubic_info.  The 8-bit
+ * idiag_ext of a request has no bit for it, so it answers a request
+ * for INET_DIAG_VEGASINFO, like the BBR record.
+ */
+#define INET_DIAG_CUBICINFO	0x3f00
+
+/* HyStart methods, for TCP_CUBIC_HYSTART and in cubic_found */
+#define TCP_CUBIC_HYSTART_ACK_TRAIN	0x1
+#define TCP_CUBIC_HYSTART_DELAY		0x2
+#define TCP_CUBIC_HYSTART_DELAY_SDEV	0x4
+#define TCP_CUBIC_HYSTART_RATE		0x8
+#define TCP_CUBIC_HYSTART_SHARED	0x10	/* a flow sharing the
+						 * bottleneck ended it */
+#define TCP_CUBIC_HYSTART_CUSTOM	0x20
+
+/* The detect bits TCP_CUBIC_HYSTART takes: all but SHARED */
+#define TCP_CUBIC_HYSTART_DETECT	(TCP_CUBIC_HYSTART_ACK_TRAIN |	\
+					 TCP_CUBIC_HYSTART_DELAY |	\
+					 TCP_CUBIC_HYSTART_DELAY_SDEV |	\
+					 TCP_CUBIC_HYSTART_RATE |	\
+					 TCP_CUBIC_HYSTART_CUSTOM)
+
+struct tcp_cubic_hystart {
+	__u32	detect;		/* TCP_CUBIC_HYSTART_* methods, fixed by
+				 * the cubic_classic/cubic_sdev variants */
+	__u32	low_window;	/* no HyStart below this cwnd, <= 255 */
+	__u32	ack_delta_ms;	/* ACK train spacing, <= 255 */
+	__u32	delay_max_ms;	/* cap of the delay margin, 0: none, <= 255 */
+};
+
+/* SCM_TIMESTAMPING_OPT_STATS attributes for tp->sdev_stats.
+ * TCP_NLA_SDEV_STOPPED is set once the congestion control stops
+ * sampling: slow start ended, by a HyStart exit, a loss or a preset
+ * ssthresh, or HyStart is off.  TCP_NLA_SDEV_FOUND tells which
+ * HyStart trigger ended it, 0 while in slow start or after an RTO.
+ */
+enum {
+	TCP_NLA_SDEV_CNT = 0x3f00, /* RTT samples */
+	TCP_NLA_SDEV_MEAN,	/* mean RTT, usec */
+	TCP_NLA_SDEV_VAR,	/* RTT variance, usec^2 */
+	TCP_NLA_SDEV_STOPPED,	/* sdev_stats sampling has stopped */
+	TCP_NLA_SDEV_FOUND,	/* TCP_CUBIC_HYSTART_* that ended slow start */
+};
+
+/* Fits the 20 bytes of union tcp_cc_info: the mean is bounded by
+ * WELFORD_VALUE_MAX, and the variance saturates at ~0U once the
+ * deviation passes 65 ms, which cubic_sdev still reports exactly.
+ * All times are in usec.
+ */
+struct tcp_cubic_info {
+	__u32	cubic_enabled:1,	/* HyStart is on */
+		cubic_found:7,		/* TCP_CUBIC_HYSTART_* that ended
+					 * slow start, 0 while in it */
+		cubic_mean:24;		/* mean RTT of tp->sdev_stats */
+	__u32	cubic_var;		/* its variance, usec^2 */
+	__u32	cubic_sdev;		/* its standard deviation */
+	__u32	cubic_curr_rtt;		/* RTT of the last HyStart round */
+	__u32	cubic_delay_min;	/* minimum RTT */
+};
+
+#endif /* _UAPI_LINUX_TCP_CUBIC_H */
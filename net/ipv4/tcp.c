@@ -420,10 +420,7 @@ void tcp_init_sock(struct sock *sk)
 	icsk->icsk_rto = TCP_TIMEOUT_INIT;
 	tp->mdev_us = jiffies_to_usecs(TCP_TIMEOUT_INIT);
 	minmax_reset(&tp->rtt_min, tcp_jiffies32, ~0U);
-	/* ***CHANGE*** */	
-	tp->sdev_stats.num_packets = 0;
-	tp->sdev_stats.mean_rtt_us = 0;
-	tp->sdev_stats.m2_rtt_ms = 0;
+	welford_reset(&tp->sdev_stats);
 
 	/* So many TCP implementations out there (incorrectly) count the
 	 * initial SYN frame in their delayed-ACK and congestion control
@@ -2617,6 +2614,32 @@ static int do_tcp_setsockopt(struct sock *sk, int level,
 
 		return tcp_fastopen_reset_cipher(net, sk, key, sizeof(key));
 	}
+	case TCP_CUBIC_HYSTART: {
+		struct tcp_cubic_hystart hs;
+		struct tcp_cubic_policy policy = { .set = 0 };
+
+		if (optlen) {
+			if (optlen != sizeof(hs))
+				return -EINVAL;
+			if (copy_from_user(&hs, optval, sizeof(hs)))
+				return -EFAULT;
+			if ((hs.detect & ~TCP_CUBIC_HYSTART_DETECT) ||
+			    hs.low_window > U8_MAX || hs.ack_delta_ms > U8_MAX ||
+			    hs.delay_max_ms > U8_MAX)
+				return -EINVAL;
+
+			policy.set = 1;
+			policy.detect = hs.detect;
+			policy.low_window = hs.low_window;
+			policy.ack_delta_ms = hs.ack_delta_ms;
+			policy.delay_max_ms = hs.delay_max_ms;
+		}
+
+		lock_sock(sk);
+		tp->cubic_hystart = policy;
+		release_sock(sk);
+		return 0;
+	}
 	default:
 		/* fallthru */
 		break;
@@ -3066,9 +3089,9 @@ struct sk_buff *tcp_get_timestamping_opt_stats(const struct sock *sk)
 	u64 rate64;
 	u32 rate;
 
-	stats = alloc_skb(7 * nla_total_size_64bit(sizeof(u64)) +
-			  3 * nla_total_size(sizeof(u32)) +
-			  2 * nla_total_size(sizeof(u8)), GFP_ATOMIC);
+	stats = alloc_skb(8 * nla_total_size_64bit(sizeof(u64)) +
+			  5 * nla_total_size(sizeof(u32)) +
+			  4 * nla_total_size(sizeof(u8)), GFP_ATOMIC);
 	if (!stats)
 		return NULL;
 
@@ -3097,6 +3120,13 @@ struct sk_buff *tcp_get_timestamping_opt_stats(const struct sock *sk)
 
 	nla_put_u8(stats, TCP_NLA_RECUR_RETRANS, inet_csk(sk)->icsk_retransmits);
 	nla_put_u8(stats, TCP_NLA_DELIVERY_RATE_APP_LMT, !!tp->rate_app_limited);
+
+	nla_put_u32(stats, TCP_NLA_SDEV_CNT, tp->sdev_stats.count);
+	nla_put_u32(stats, TCP_NLA_SDEV_MEAN, welford_mean(&tp->sdev_stats));
+	nla_put_u64_64bit(stats, TCP_NLA_SDEV_VAR,
+			  welford_var(&tp->sdev_stats), TCP_NLA_PAD);
+	nla_put_u8(stats, TCP_NLA_SDEV_STOPPED, tp->sdev_frozen);
+	nla_put_u8(stats, TCP_NLA_SDEV_FOUND, tp->cubic_found);
 	return stats;
 }
 
@@ -3189,6 +3219,48 @@ static int do_tcp_getsockopt(struct sock *sk, int level,
 			return -EFAULT;
 		return 0;
 	}
+	case TCP_CUBIC_INFO: {
+		const struct tcp_congestion_ops *ca_ops;
+		union tcp_cc_info info;
+		size_t sz = 0;
+		int attr = INET_DIAG_NONE;
+
+		if (get_user(len, optlen))
+			return -EFAULT;
+
+		ca_ops = icsk->icsk_ca_ops;
+		if (ca_ops && ca_ops->get_info) {
+			sz = ca_ops->get_info(sk, ~0U, &attr, &info);
+			if (attr != INET_DIAG_CUBICINFO)
+				sz = 0;
+		}
+
+		len = min_t(unsigned int, len, sz);
+		if (put_user(len, optlen))
+			return -EFAULT;
+		if (copy_to_user(optval, &info, len))
+			return -EFAULT;
+		return 0;
+	}
+	case TCP_CUBIC_HYSTART: {
+		struct tcp_cubic_policy policy = tp->cubic_hystart;
+		struct tcp_cubic_hystart hs = {
+			.detect		= policy.detect,
+			.low_window	= policy.low_window,
+			.ack_delta_ms	= policy.ack_delta_ms,
+			.delay_max_ms	= policy.delay_max_ms,
+		};
+
+		if (get_user(len, optlen))
+			return -EFAULT;
+
+		len = policy.set ? min_t(unsigned int, len, sizeof(hs)) : 0;
+		if (put_user(len, optlen))
+			return -EFAULT;
+		if (copy_to_user(optval, &hs, len))
+			return -EFAULT;
+		return 0;
+	}
 	case TCP_QUICKACK:
 		val = !icsk->icsk_ack.pingpong;
 		break;
@@ -3620,6 +3692,16 @@ void __init tcp_init(void)
 	BUILD_BUG_ON(TCP_MIN_SND_MSS <= MAX_TCP_OPTION_SPACE);
 	BUILD_BUG_ON(sizeof(struct tcp_skb_cb) >
 		     FIELD_SIZEOF(struct sk_buff, cb));
+	/* The HyStart block must stay behind the last stock member of
+	 * tcp_sock, so that srtt_us, packets_out, rtt_min and the rest of
+	 * the ACK path keep their stock offsets and cachelines, and must
+	 * not cost every socket more than 32 bytes.
+	 */
+	BUILD_BUG_ON(sizeof(struct welford) != 2 * sizeof(u64));
+	BUILD_BUG_ON(offsetof(struct tcp_sock, sdev_stats) <
+		     offsetofend(struct tcp_sock, saved_syn));
+	BUILD_BUG_ON(offsetofend(struct tcp_sock, cubic_found) -
+		     offsetof(struct tcp_sock, sdev_stats) > 32);
 
 	percpu_counter_init(&tcp_sockets_allocated, 0, GFP_KERNEL);
 	percpu_counter_init(&tcp_orphan_count, 0, GFP_KERNEL);
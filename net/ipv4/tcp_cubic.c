@@ -26,23 +26,104 @@
 #include <linux/mm.h>
 #include <linux/module.h>
 #include <linux/math64.h>
+#include <linux/hash.h>
+#include <linux/jump_label.h>
+#include <linux/mutex.h>
+#include <linux/slab.h>
+#include <linux/percpu.h>
+#include <linux/proc_fs.h>
+#include <linux/seq_file.h>
+#include <net/inetpeer.h>
+#include <net/ipv6.h>
+#include <net/snmp.h>
 #include <net/tcp.h>
+#include <net/tcp_cubic.h>
+
+#define CREATE_TRACE_POINTS
+#include <trace/events/tcp_cubic.h>
 
 #define BICTCP_BETA_SCALE    1024	/* Scale factor beta calculation
 					 * max_cwnd = snd_cwnd * beta
 					 */
 #define	BICTCP_HZ		10	/* BIC HZ 2^10 = 1024 */
 
-/* Two methods of hybrid slow start */
+/* Three methods of hybrid slow start */
 #define HYSTART_ACK_TRAIN	0x1
 #define HYSTART_DELAY		0x2
+#define HYSTART_DELAY_SDEV	0x4	/* delay above delay_min + k * sdev */
+#define HYSTART_RATE		0x8	/* delivery rate stopped growing */
+/* Not a detection method: a flow sharing the bottleneck left slow start */
+#define HYSTART_SHARED		0x10
+#define HYSTART_CUSTOM		0x20	/* registered cubic_hystart_ops */
+#define HYSTART_DELAY_ANY	(HYSTART_DELAY | HYSTART_DELAY_SDEV | \
+				 HYSTART_CUSTOM)
+
+/* Delivery rate in packets per usec << HYSTART_RATE_SCALE */
+#define HYSTART_RATE_SCALE	24
+
+/* Longest epoch bictcp_update() tracks, about 35 minutes: keeps the u32
+ * usec epoch_start from wrapping
+ */
+#define CUBIC_EPOCH_MAX_US	((u32)S32_MAX)
+
+/* Conservative slow start (RFC 9406) rounds after a delay trigger */
+#define HYSTART_CSS_ROUNDS_MAX	7
+
+/* Slow start flight recorder: ACKs kept, and why it was emitted */
+#define CUBIC_SS_RING_SIZE	256	/* a power of two */
+#define CUBIC_SS_EXIT		0	/* HyStart found the exit point */
+#define CUBIC_SS_LOSS		1	/* first loss or ECN reduction */
+#define CUBIC_SS_SSTHRESH	2	/* cwnd reached a preset ssthresh */
+#define CUBIC_SS_CLOSE		3	/* released while in slow start */
+
+/* Number of delay samples for detecting the increase of delay.  The
+ * delay triggers are evaluated once this many samples into a round and
+ * again each time the round's sample count doubles, up to
+ * HYSTART_EVAL_MAX, so their cost is per round rather than per ACK.
+ * The round's minimum RTT is taken over the first HYSTART_MIN_SAMPLES
+ * only; later checkpoints matter for the percentile and for the
+ * margins, which move with delay_min and the deviation.
+ */
+#define HYSTART_MIN_SAMPLES	8	/* a power of two */
+#define HYSTART_EVAL_MAX	128
+#define HYSTART_DELAY_MIN	((u32)hystart_delay_min)
+/* #define HYSTART_DELAY_MAX	(16000U) */
+#define HYSTART_DELAY_MAX(ca)	bictcp_delay_max(ca)
+#define HYSTART_DELAY_THRESH(ca, x)	\
+	clamp(x, HYSTART_DELAY_MIN, HYSTART_DELAY_MAX(ca))
+
+/* RTT deviation estimators for the HYSTART_DELAY threshold */
+#define HYSTART_SDEV_OFF	0	/* use delay_min / 8 */
+#define HYSTART_SDEV_CUMULATIVE	1	/* Welford since the connection began */
+#define HYSTART_SDEV_ROUND	2	/* Welford restarted every round */
+#define HYSTART_SDEV_EWMA	3	/* exponentially weighted variance */
+#define HYSTART_SDEV_EWMA_MAX	16
+/* hystart_sdev_k is in units of 1/4 */
+#define HYSTART_SDEV_K_SHIFT	2
+
+/* Per-round histogram of the delay above delay_min: 16 nibble counters
+ * in half-octave buckets, bucket 1 starting at 2^shift usec and the top
+ * one at 2^(shift + 7).  The shift is picked per round, from
+ * HYSTART_HIST_BASE_SHIFT up to HYSTART_HIST_SHIFT_MAX, so that the top
+ * bucket lies above the margins the delay triggers use.
+ */
+#define HYSTART_HIST_BUCKETS	16
+#define HYSTART_HIST_BASE_SHIFT	7	/* 128 usec, top bucket at 16 ms */
+#define HYSTART_HIST_SHIFT_MAX	(HYSTART_HIST_BASE_SHIFT + 15)
+#define HYSTART_HIST_NIBBLE_MAX	15ULL
 
-/* Number of delay samples for detecting the increase of delay */
-#define HYSTART_MIN_SAMPLES	8
-#define HYSTART_DELAY_MIN	(4U<<3)
-/* #define HYSTART_DELAY_MAX	(16U<<3) */
-#define HYSTART_DELAY_MAX	(hystart_delay_max ? (16U<<3) : INT_MAX)
-#define HYSTART_DELAY_THRESH(x)	clamp(x, HYSTART_DELAY_MIN, HYSTART_DELAY_MAX)
+/* An exit whose cwnd then grows this many times past it without loss
+ * was premature
+ */
+#define HYSTART_PREMATURE_FACTOR	2
+
+/* Per-destination cache of the HyStart exit point */
+#define CUBIC_DST_HASH_LOG	10
+#define CUBIC_DST_DEPTH		5	/* entries per chain before recycling */
+#define CUBIC_DST_TIMEOUT	(60 * 60 * HZ)
+#define CUBIC_DST_SEED_COUNT	16	/* weight of the cached RTT statistics */
+#define CUBIC_DST_SLOTS_LOG	3	/* flows sharing one entry's estimate */
+#define CUBIC_DST_LIVE_TIMEOUT	(10 * HZ)
 
 static int fast_convergence __read_mostly = 1;
 static int beta __read_mostly = 717;	/* = 717/1024 (BICTCP_BETA_SCALE) */
@@ -58,13 +139,31 @@ static int hystart_ack_delta __read_mostly = 2;
  * HYSTART_DELAY_THRESH between 16ms and UINT_MAX
  */
 static int hystart_delay_max __read_mostly = 1;
+static int hystart_delay_min __read_mostly = 4000;	/* usec */
+static int hystart_sdev_mode __read_mostly = HYSTART_SDEV_OFF;
+static int hystart_sdev_ewma_shift __read_mostly = 3;
+static int hystart_sdev_k __read_mostly = 3 << HYSTART_SDEV_K_SHIFT;
+static int hystart_sdev_min __read_mostly = 4000;	/* usec */
+static int hystart_sdev_max __read_mostly = 100000;	/* usec */
+/* Emit the cubic_acked record for every socket rather than only for
+ * sockets that set SO_DEBUG.
+ */
+static int telemetry __read_mostly;
+static int hystart_dst_cache __read_mostly;
+static int hystart_dst_share __read_mostly;
+static int hystart_sdev_samples __read_mostly;
+static int hystart_rtt_percentile __read_mostly;
+static int hystart_rate_growth __read_mostly = 25;	/* percent per round */
+static int hystart_rate_rounds __read_mostly = 3;
+static int hystart_exit_loss_rtts __read_mostly = 4;
+static int hystart_pacing_drain __read_mostly;
+static int hystart_css_rounds __read_mostly;
+static int hystart_css_growth_divisor __read_mostly = 4;
 
 static u32 cube_rtt_scale __read_mostly;
 static u32 beta_scale __read_mostly;
 static u64 cube_factor __read_mostly;
 
-//int total_pkts = 0;
-
 /* Note parameters that are used for precomputing scale factors are read-only */
 module_param(fast_convergence, int, 0644);
 MODULE_PARM_DESC(fast_convergence, "turn on/off fast convergence");
@@ -80,7 +179,9 @@ module_param(hystart, int, 0644);
 MODULE_PARM_DESC(hystart, "turn on/off hybrid slow start algorithm");
 module_param(hystart_detect, int, 0644);
 MODULE_PARM_DESC(hystart_detect, "hybrid slow start detection mechanisms"
-		 " 1: packet-train 2: delay 3: both packet-train and delay");
+		 " 1: packet-train 2: delay 4: delay above k * sdev"
+		 " 8: delivery rate plateau 32: registered predicate"
+		 " (bitmask, 3: both packet-train and delay)");
 module_param(hystart_low_window, int, 0644);
 MODULE_PARM_DESC(hystart_low_window, "lower bound cwnd for hybrid slow start");
 module_param(hystart_ack_delta, int, 0644);
@@ -91,27 +192,125 @@ module_param(hystart_delay_max, int, 0644);
 MODULE_PARM_DESC(hystart_delay_max, "Enable or disable upper bound clamping of HYSTART_DELAY_THRESH"
 		"0: Clamp between HYSTART_DELAY_MIN and UINT_MAX"
 		"1: Clamp between HYSTART_DELAY_MIN and HYSTART_DELAY_MAX");
+module_param(hystart_delay_min, int, 0644);
+MODULE_PARM_DESC(hystart_delay_min, "lower bound of the HYSTART_DELAY_THRESH"
+		 " margin (usecs), lower it for sub-ms paths");
+module_param(hystart_sdev_mode, int, 0644);
+MODULE_PARM_DESC(hystart_sdev_mode, "RTT deviation driving HYSTART_DELAY_THRESH"
+		 " 0: none (delay_min / 8) 1: cumulative Welford"
+		 " 2: Welford reset every round 3: EWMA");
+module_param(hystart_sdev_ewma_shift, int, 0644);
+MODULE_PARM_DESC(hystart_sdev_ewma_shift, "gain of the EWMA RTT deviation"
+		 " as a power of two (gain = 1/2^shift, 1..16)");
+module_param(hystart_sdev_k, int, 0644);
+MODULE_PARM_DESC(hystart_sdev_k, "sdev multiplier k of the sdev delay trigger,"
+		 " in units of 1/4");
+module_param(hystart_sdev_min, int, 0644);
+MODULE_PARM_DESC(hystart_sdev_min, "lower bound of k * sdev (usecs)");
+module_param(hystart_sdev_max, int, 0644);
+MODULE_PARM_DESC(hystart_sdev_max, "upper bound of k * sdev (usecs)");
+module_param(telemetry, int, 0644);
+MODULE_PARM_DESC(telemetry, "record cubic_acked trace events for all sockets"
+		 " (0: only SO_DEBUG sockets, 1: all sockets); also keeps"
+		 " the RTT statistics that no HyStart trigger reads");
+module_param(hystart_sdev_samples, int, 0644);
+MODULE_PARM_DESC(hystart_sdev_samples, "RTT samples feeding the deviation"
+		 " estimator (0: one per ACK, 1: every (S)ACKed skb)");
+module_param(hystart_rtt_percentile, int, 0644);
+MODULE_PARM_DESC(hystart_rtt_percentile, "percentile of the round's delays"
+		 " used as curr_rtt (0: minimum of the first samples)");
+module_param(hystart_rate_growth, int, 0644);
+MODULE_PARM_DESC(hystart_rate_growth, "delivery rate growth per round (percent)"
+		 " below which a round counts towards the rate plateau");
+module_param(hystart_rate_rounds, int, 0644);
+MODULE_PARM_DESC(hystart_rate_rounds, "rounds without rate growth before"
+		 " the rate plateau trigger leaves slow start (1..3)");
+module_param(hystart_exit_loss_rtts, int, 0644);
+MODULE_PARM_DESC(hystart_exit_loss_rtts, "a loss this many srtts after a"
+		 " HyStart exit counts as HyStartExitLoss");
+module_param(hystart_pacing_drain, int, 0644);
+MODULE_PARM_DESC(hystart_pacing_drain, "rounds paced at the delivery rate"
+		 " after a delay based HyStart exit (0: off, at most 3)");
+module_param(hystart_css_rounds, int, 0644);
+MODULE_PARM_DESC(hystart_css_rounds, "rounds of conservative slow start after"
+		 " a delay trigger before leaving slow start"
+		 " (0: leave at once, at most 7)");
+module_param(hystart_css_growth_divisor, int, 0644);
+MODULE_PARM_DESC(hystart_css_growth_divisor, "slow start growth is divided"
+		 " by this during conservative slow start");
+module_param(hystart_dst_cache, int, 0644);
+MODULE_PARM_DESC(hystart_dst_cache, "remember the HyStart exit point per"
+		 " destination and seed new connections from it");
+module_param(hystart_dst_share, int, 0644);
+MODULE_PARM_DESC(hystart_dst_share, "share RTT statistics and delay_min"
+		 " between concurrent flows to a destination, and end their"
+		 " slow start together");
+
+/* HyStart outcome counters, next to the LINUX_MIB_TCPHYSTART* ones in
+ * /proc/net/netstat, but module wide: /proc/net/tcp_cubic.
+ */
+enum {
+	CUBIC_MIB_SDEVDETECT,		/* HyStartSdevDetect */
+	CUBIC_MIB_SDEVCWND,		/* HyStartSdevCwnd */
+	CUBIC_MIB_RATEDETECT,		/* HyStartRateDetect */
+	CUBIC_MIB_RATECWND,		/* HyStartRateCwnd */
+	CUBIC_MIB_PREMATURE,		/* HyStartPremature */
+	CUBIC_MIB_EXITLOSS,		/* HyStartExitLoss */
+	CUBIC_MIB_SDEVSATURATED,	/* HyStartSdevSaturated */
+	CUBIC_MIB_CSSENTER,		/* HyStartCssEnter */
+	CUBIC_MIB_CSSRESUME,		/* HyStartCssResume */
+	CUBIC_MIB_SHAREDEXIT,		/* HyStartSharedExit */
+	__CUBIC_MIB_MAX
+};
+
+struct cubic_mib {
+	unsigned long	mibs[__CUBIC_MIB_MAX];
+};
+
+static DEFINE_PER_CPU(struct cubic_mib, cubic_mib);
+
+#define CUBIC_INC_STATS(field)		this_cpu_inc(cubic_mib.mibs[field])
+#define CUBIC_ADD_STATS(field, val)	this_cpu_add(cubic_mib.mibs[field], val)
 
 /* BIC TCP Parameters */
 struct bictcp {
 	u32	cnt;		/* increase cwnd by 1 after ACKs */
 	u32	last_max_cwnd;	/* last maximum snd_cwnd */
 	u32	last_cwnd;	/* the last snd_cwnd */
-	u32	last_time;	/* time when updated last_cwnd */
+	u32	last_time;	/* time when updated last_cwnd (usec) */
 	u32	bic_origin_point;/* origin point of bic function */
 	u32	bic_K;		/* time to origin point
 				   from the beginning of the current epoch */
-	u32	delay_min;	/* min delay (msec << 3) */
-	u32	epoch_start;	/* beginning of an epoch */
-	u32	ack_cnt;	/* number of acks */
+	u32	delay_min;	/* min delay (usec) */
+	u32	epoch_start;	/* beginning of an epoch (usec) */
+	u32	ack_cnt;	/* number of acks, in CSS the growth
+				 * credit below one packet */
 	u32	tcp_cwnd;	/* estimated tcp cwnd */
-	u16	unused;
-	u8	sample_cnt;	/* number of samples to decide curr_rtt */
-	u8	found;		/* the exit point is found? */
-	u32	round_start;	/* beginning of each round */
-	u32	end_seq;	/* end_seq of the round */
-	u32	last_ack;	/* last time when the ACK spacing is close */
-	u32	curr_rtt;	/* the minimum rtt of current round */
+	u16	rate_rounds:2,	/* rounds without delivery rate growth */
+		exit_pending:1,	/* HyStart exited, no loss seen since */
+		sdev_saturated:1, /* HyStartSdevSaturated counted */
+		drain_rounds:2,	/* rounds left pacing at the exit rate */
+		css_rounds:3,	/* conservative slow start rounds left */
+		css_sdev:1,	/* CSS entered on HYSTART_DELAY_SDEV */
+		ss_recorded:1,	/* flight recorder used, once per connection */
+		hist_shift:4,	/* rtt_hist base, above HYSTART_HIST_BASE_SHIFT */
+		sdev_off:1;	/* nothing reads tp->sdev_stats */
+	u8	sample_cnt;	/* delay samples this round, saturating */
+	u8	found:7,	/* the exit point is found? */
+		delay_seeded:1;	/* delay_min is from cubic_dst, not measured */
+	u32	round_start;	/* beginning of each round, or of the
+				 * HyStart exit while exit_pending (usec) */
+	u32	end_seq;	/* end_seq of the round, also of the
+				 * drain round while drain_rounds */
+	u32	last_ack;	/* last time when the ACK spacing is close
+				 * (usec) */
+	u32	curr_rtt;	/* the minimum rtt of current round's
+				 * first samples, or its percentile */
+	struct tcp_cubic_policy policy;	/* TCP_CUBIC_HYSTART at init */
+	u64	rtt_hist;	/* histogram of delay above delay_min */
+	u32	round_rate;	/* max delivery rate of current round */
+	u32	full_rate;	/* rate the plateau detector compares with */
+	struct cubic_ss_ring *ss_ring;	/* slow start flight recorder */
 };
 
 static inline void bictcp_reset(struct bictcp *ca)
@@ -127,15 +326,53 @@ static inline void bictcp_reset(struct bictcp *ca)
 	ca->ack_cnt = 0;
 	ca->tcp_cwnd = 0;
 	ca->found = 0;
+	ca->delay_seeded = 0;
+	ca->rate_rounds = 0;
+	ca->exit_pending = 0;
+	ca->sdev_saturated = 0;
+	ca->drain_rounds = 0;
+	ca->css_rounds = 0;
+	ca->css_sdev = 0;
+	ca->full_rate = 0;
 }
 
-static inline u32 bictcp_clock(void)
+/* The TCP_CUBIC_HYSTART policy of the socket, else the module parameters */
+static inline u32 bictcp_low_window(const struct bictcp *ca)
 {
-#if HZ < 1000
-	return ktime_to_ms(ktime_get_real());
-#else
-	return jiffies_to_msecs(jiffies);
-#endif
+	return unlikely(ca->policy.set) ? ca->policy.low_window :
+					  hystart_low_window;
+}
+
+static inline int bictcp_detect(const struct sock *sk)
+{
+	const struct bictcp *ca = inet_csk_ca(sk);
+
+	return unlikely(ca->policy.set) ? ca->policy.detect : hystart_detect;
+}
+
+static inline int bictcp_ack_delta_us(const struct bictcp *ca)
+{
+	return (unlikely(ca->policy.set) ? ca->policy.ack_delta_ms :
+					   hystart_ack_delta) * USEC_PER_MSEC;
+}
+
+static inline u32 bictcp_delay_max(const struct bictcp *ca)
+{
+	if (unlikely(ca->policy.set))
+		return ca->policy.delay_max_ms ?
+		       ca->policy.delay_max_ms * USEC_PER_MSEC : INT_MAX;
+	return hystart_delay_max ? 16000U : INT_MAX;
+}
+
+/* CUBIC's time base, in usec.  tp->tcp_mstamp comes from the monotonic
+ * tcp_clock_us() and is refreshed once per incoming segment before the
+ * congestion control hooks run, so reading it costs no clock access and
+ * its resolution does not depend on HZ.  The low 32 bits wrap every 71
+ * minutes; all users take differences within a round or an epoch.
+ */
+static inline u32 bictcp_clock_us(const struct sock *sk)
+{
+	return tcp_sk(sk)->tcp_mstamp;
 }
 
 static inline void bictcp_hystart_reset(struct sock *sk)
@@ -143,19 +380,457 @@ static inline void bictcp_hystart_reset(struct sock *sk)
 	struct tcp_sock *tp = tcp_sk(sk);
 	struct bictcp *ca = inet_csk_ca(sk);
 
-	ca->round_start = ca->last_ack = bictcp_clock();
+	ca->round_start = ca->last_ack = bictcp_clock_us(sk);
 	ca->end_seq = tp->snd_nxt;
 	ca->curr_rtt = 0;
 	ca->sample_cnt = 0;
+	ca->rtt_hist = 0;
+	ca->round_rate = 0;
+
+	if (hystart_sdev_mode == HYSTART_SDEV_ROUND)
+		welford_reset(&tp->sdev_stats);
+}
+
+/* HyStart is the only consumer of tp->sdev_stats; stop feeding it once
+ * slow start is over so congestion avoidance costs the same as before.
+ */
+static inline void bictcp_sdev_freeze(struct sock *sk, bool frozen)
+{
+	tcp_sk(sk)->sdev_frozen = frozen;
+}
+
+/* Whether anything reads tp->sdev_stats for this socket: the sdev
+ * trigger or margins, the custom predicate, the destination cache or
+ * the telemetry (tracepoints, flight recorder, and the mean and
+ * variance in INET_DIAG and OPT_STATS).  Without a reader, slow start
+ * does not pay for the updates either.
+ */
+static bool bictcp_sdev_wanted(const struct sock *sk, int detect)
+{
+	return (detect & (HYSTART_DELAY_SDEV | HYSTART_CUSTOM)) ||
+	       hystart_sdev_mode != HYSTART_SDEV_OFF ||
+	       hystart_dst_cache || hystart_dst_share ||
+	       telemetry || sock_flag(sk, SOCK_DBG);
+}
+
+static void bictcp_sdev_init(struct sock *sk, int detect)
+{
+	struct tcp_sock *tp = tcp_sk(sk);
+	struct bictcp *ca = inet_csk_ca(sk);
+
+	if (hystart_sdev_mode == HYSTART_SDEV_EWMA)
+		tp->sdev_ewma_shift = clamp(hystart_sdev_ewma_shift, 1,
+					    HYSTART_SDEV_EWMA_MAX);
+	else
+		tp->sdev_ewma_shift = 0;
+	tp->rtt_samples = !!hystart_sdev_samples;
+	ca->sdev_off = !bictcp_sdev_wanted(sk, detect);
+	bictcp_sdev_freeze(sk, !hystart || ca->sdev_off);
+}
+
+/* Short transfers to the same destination would otherwise rediscover
+ * delay_min, the RTT spread and a safe ssthresh on every connection.
+ * Keep what the last HyStart exit found, keyed like tcp_metrics by
+ * (netns, daddr).  The chains are walked under RCU.  Entries are only
+ * created, under cubic_dst_lock, when a flow starts; a full chain then
+ * replaces its oldest entry so the cache never grows beyond
+ * CUBIC_DST_DEPTH entries per bucket.  The contents of an entry are
+ * guarded by its own lock, so flows to different destinations never
+ * contend and slow start rounds neither allocate nor touch the global
+ * lock.
+ *
+ * With hystart_dst_share the entry is also the shared estimate of the
+ * bottleneck for flows to the destination that run at the same time.
+ * Every round each flow in slow start publishes its tp->sdev_stats and
+ * delay_min into its slot (picked by port hash, so colliding flows
+ * overwrite each other rather than double count), and takes the lowest
+ * delay_min of the live slots, which a flow starting behind its siblings'
+ * queue cannot measure itself.  A new flow starts from the Welford merge
+ * of all live slots.  When one flow leaves slow start on its own, the
+ * others leave at their next round boundary instead of each overshooting
+ * into the same queue.
+ */
+struct cubic_dst_slot {
+	struct welford		stats;		/* the flow's tp->sdev_stats */
+	u32			delay_min;
+	unsigned long		stamp;		/* jiffies, 0: free */
+};
+
+struct cubic_dst {
+	struct cubic_dst __rcu	*next;
+	struct rcu_head		rcu_head;
+	possible_net_t		net;
+	struct inetpeer_addr	daddr;
+	spinlock_t		lock;		/* guards the fields below */
+	unsigned long		stamp;		/* jiffies of the last update */
+	unsigned long		cache_stamp;	/* jiffies of the exit point
+						 * below, 0: none */
+	struct welford		stats;		/* tp->sdev_stats at exit */
+	u32			delay_min;	/* ca->delay_min at exit */
+	u32			exit_cwnd;	/* snd_cwnd at exit, 0: it
+						 * proved premature */
+	unsigned long		exit_stamp;	/* jiffies of the last shared
+						 * flow's own exit, 0: none
+						 * within LIVE_TIMEOUT */
+	u32			exit_us;	/* bictcp_clock_us() of it */
+	struct cubic_dst_slot	slots[1 << CUBIC_DST_SLOTS_LOG];
+};
+
+static struct cubic_dst __rcu *cubic_dst_hash[1 << CUBIC_DST_HASH_LOG];
+static DEFINE_SPINLOCK(cubic_dst_lock);
+
+static bool cubic_dst_key(const struct sock *sk, struct inetpeer_addr *daddr,
+			  unsigned int *hash)
+{
+	unsigned int h;
+
+	switch (sk->sk_family) {
+	case AF_INET:
+		inetpeer_set_addr_v4(daddr, inet_sk(sk)->inet_daddr);
+		h = (__force unsigned int)inet_sk(sk)->inet_daddr;
+		break;
+#if IS_ENABLED(CONFIG_IPV6)
+	case AF_INET6:
+		if (ipv6_addr_v4mapped(&sk->sk_v6_daddr)) {
+			inetpeer_set_addr_v4(daddr, inet_sk(sk)->inet_daddr);
+			h = (__force unsigned int)inet_sk(sk)->inet_daddr;
+		} else {
+			inetpeer_set_addr_v6(daddr, &sk->sk_v6_daddr);
+			h = ipv6_addr_hash(&sk->sk_v6_daddr);
+		}
+		break;
+#endif
+	default:
+		return false;
+	}
+
+	*hash = hash_32(h ^ net_hash_mix(sock_net(sk)), CUBIC_DST_HASH_LOG);
+	return true;
+}
+
+static struct cubic_dst *cubic_dst_lookup(const struct inetpeer_addr *daddr,
+					  const struct net *net,
+					  unsigned int hash)
+{
+	struct cubic_dst *d;
+
+	for (d = rcu_dereference(cubic_dst_hash[hash]); d;
+	     d = rcu_dereference(d->next)) {
+		if (!inetpeer_addr_cmp(&d->daddr, daddr) &&
+		    net_eq(read_pnet(&d->net), net))
+			break;
+	}
+	return d;
+}
+
+/* Find the destination's entry, or create one.  Entries are filled in
+ * before they are published and never change key once readers can see
+ * them: a full chain unlinks its oldest entry and frees it after a grace
+ * period rather than reuse it.
+ */
+static struct cubic_dst *cubic_dst_get_locked(const struct sock *sk,
+					      const struct inetpeer_addr *daddr,
+					      unsigned int hash)
+{
+	struct cubic_dst __rcu **pp, **oldest_pp = NULL;
+	struct cubic_dst *d, *oldest = NULL;
+	int depth = 0;
+
+	for (pp = &cubic_dst_hash[hash];
+	     (d = rcu_dereference_protected(*pp,
+					    lockdep_is_held(&cubic_dst_lock)));
+	     pp = &d->next) {
+		if (!inetpeer_addr_cmp(&d->daddr, daddr) &&
+		    net_eq(read_pnet(&d->net), sock_net(sk)))
+			return d;
+		if (!oldest || time_before(READ_ONCE(d->stamp),
+					   READ_ONCE(oldest->stamp))) {
+			oldest = d;
+			oldest_pp = pp;
+		}
+		depth++;
+	}
+
+	d = kmalloc(sizeof(*d), GFP_ATOMIC);
+	if (!d)
+		return NULL;
+	write_pnet(&d->net, sock_net(sk));
+	d->daddr = *daddr;
+	spin_lock_init(&d->lock);
+	d->stamp = jiffies;
+	d->cache_stamp = 0;
+	welford_reset(&d->stats);
+	d->delay_min = 0;
+	d->exit_cwnd = 0;
+	d->exit_stamp = 0;
+	d->exit_us = 0;
+	memset(d->slots, 0, sizeof(d->slots));
+
+	if (depth >= CUBIC_DST_DEPTH) {
+		RCU_INIT_POINTER(*oldest_pp,
+				 rcu_dereference_protected(oldest->next,
+					lockdep_is_held(&cubic_dst_lock)));
+		kfree_rcu(oldest, rcu_head);
+	}
+	RCU_INIT_POINTER(d->next,
+			 rcu_dereference_protected(cubic_dst_hash[hash],
+					lockdep_is_held(&cubic_dst_lock)));
+	rcu_assign_pointer(cubic_dst_hash[hash], d);
+	return d;
+}
+
+/* The destination's entry under rcu_read_lock(), created if need be
+ * only when the caller is a flow starting
+ */
+static struct cubic_dst *cubic_dst_get(const struct sock *sk,
+				       const struct inetpeer_addr *daddr,
+				       unsigned int hash, bool create)
+{
+	struct cubic_dst *d;
+
+	d = cubic_dst_lookup(daddr, sock_net(sk), hash);
+	if (d || !create)
+		return d;
+
+	spin_lock_bh(&cubic_dst_lock);
+	d = cubic_dst_get_locked(sk, daddr, hash);
+	spin_unlock_bh(&cubic_dst_lock);
+	return d;
+}
+
+/* Called with d->lock held */
+static void cubic_dst_publish_locked(struct cubic_dst *d,
+				     const struct sock *sk)
+{
+	const struct inet_sock *inet = inet_sk(sk);
+	const struct bictcp *ca = inet_csk_ca(sk);
+	struct cubic_dst_slot *slot;
+
+	slot = &d->slots[hash_32((__force u32)inet->inet_sport << 16 |
+				 (__force u32)inet->inet_dport,
+				 CUBIC_DST_SLOTS_LOG)];
+	slot->stats = tcp_sk(sk)->sdev_stats;
+	slot->delay_min = ca->delay_min;
+	slot->stamp = jiffies ?: 1;
+}
+
+/* Record the exit point; called once per connection from hystart_exit().
+ * The entry was created when the flow started; if it has been recycled
+ * since, the exit point is not worth an allocation here.
+ */
+static void cubic_dst_store(struct sock *sk, u32 trigger)
+{
+	const struct tcp_sock *tp = tcp_sk(sk);
+	const struct bictcp *ca = inet_csk_ca(sk);
+	struct inetpeer_addr daddr;
+	struct cubic_dst *d;
+	unsigned int hash;
+
+	if (!cubic_dst_key(sk, &daddr, &hash))
+		return;
+
+	rcu_read_lock();
+	d = cubic_dst_get(sk, &daddr, hash, false);
+	if (!d)
+		goto out;
+
+	spin_lock_bh(&d->lock);
+	if (hystart_dst_cache) {
+		d->stats = tp->sdev_stats;
+		d->delay_min = ca->delay_min;
+		d->exit_cwnd = tp->snd_cwnd;
+		d->cache_stamp = jiffies ?: 1;
+	}
+	if (hystart_dst_share) {
+		cubic_dst_publish_locked(d, sk);
+		if (trigger != HYSTART_SHARED) {
+			d->exit_stamp = jiffies ?: 1;
+			d->exit_us = bictcp_clock_us(sk);
+		}
+	}
+	WRITE_ONCE(d->stamp, jiffies);
+	spin_unlock_bh(&d->lock);
+out:
+	rcu_read_unlock();
+}
+
+/* The flow grew to HYSTART_PREMATURE_FACTOR times its exit cwnd without
+ * a loss: the exit point it stored was premature and must not cap the
+ * ssthresh of later connections.  The record is only dropped while it
+ * is still this flow's, whose ssthresh is the exit cwnd until a loss.
+ */
+static void cubic_dst_premature(struct sock *sk)
+{
+	const struct tcp_sock *tp = tcp_sk(sk);
+	struct inetpeer_addr daddr;
+	struct cubic_dst *d;
+	unsigned int hash;
+
+	if (!cubic_dst_key(sk, &daddr, &hash))
+		return;
+
+	rcu_read_lock();
+	d = cubic_dst_get(sk, &daddr, hash, false);
+	if (d) {
+		spin_lock_bh(&d->lock);
+		if (d->exit_cwnd == tp->snd_ssthresh)
+			d->exit_cwnd = 0;
+		spin_unlock_bh(&d->lock);
+	}
+	rcu_read_unlock();
+}
+
+/* Round boundary of a shared flow in slow start: publish, take the
+ * siblings' delay_min, and tell whether one of them left slow start
+ * during the round that just ended.  An exit only counts while it is
+ * live: exit_us is a u32 usec stamp, which is only comparable with
+ * round_start while both are recent.
+ */
+static bool cubic_dst_round(struct sock *sk)
+{
+	struct bictcp *ca = inet_csk_ca(sk);
+	struct inetpeer_addr daddr;
+	struct cubic_dst *d;
+	unsigned int hash, i;
+	bool exit = false;
+
+	if (!cubic_dst_key(sk, &daddr, &hash))
+		return false;
+
+	rcu_read_lock();
+	d = cubic_dst_get(sk, &daddr, hash, false);
+	if (!d)
+		goto out;
+
+	spin_lock_bh(&d->lock);
+	if (d->exit_stamp) {
+		if (time_before(jiffies,
+				d->exit_stamp + CUBIC_DST_LIVE_TIMEOUT))
+			exit = (s32)(d->exit_us - ca->round_start) >= 0;
+		else
+			d->exit_stamp = 0;
+	}
+	for (i = 0; i < ARRAY_SIZE(d->slots); i++) {
+		const struct cubic_dst_slot *slot = &d->slots[i];
+
+		if (slot->stamp && slot->delay_min &&
+		    time_before(jiffies, slot->stamp + CUBIC_DST_LIVE_TIMEOUT) &&
+		    slot->delay_min < ca->delay_min)
+			ca->delay_min = slot->delay_min;
+	}
+	cubic_dst_publish_locked(d, sk);
+	WRITE_ONCE(d->stamp, jiffies);
+	spin_unlock_bh(&d->lock);
+out:
+	rcu_read_unlock();
+	return exit;
 }
 
+/* Start from the live flows to this destination if they are shared, or
+ * else from the last exit point to it, if it is recent.  The statistics
+ * are scaled down to CUBIC_DST_SEED_COUNT samples so that the new
+ * connection's own RTTs take over quickly, and the exit cwnd only
+ * becomes ssthresh when nothing else (route metrics, socket options)
+ * has set one and the exit did not prove premature.  A cached delay_min
+ * may predate a route change that raised the base RTT, so it only
+ * stands in until the connection's first RTT sample.  This is where a
+ * destination's entry is created.
+ */
+static void cubic_dst_seed(struct sock *sk)
+{
+	struct tcp_sock *tp = tcp_sk(sk);
+	struct bictcp *ca = inet_csk_ca(sk);
+	struct inetpeer_addr daddr;
+	struct welford stats;
+	struct cubic_dst *d;
+	unsigned int hash, i;
+	u32 delay_min = 0, exit_cwnd = 0, seed;
+	bool cached = false;
+
+	if (!cubic_dst_key(sk, &daddr, &hash))
+		return;
+
+	welford_reset(&stats);
+	rcu_read_lock();
+	d = cubic_dst_get(sk, &daddr, hash, true);
+	if (!d)
+		goto out;
+
+	spin_lock_bh(&d->lock);
+	if (hystart_dst_share) {
+		/* concurrent flows first: the merge of every live slot */
+		for (i = 0; i < ARRAY_SIZE(d->slots); i++) {
+			const struct cubic_dst_slot *slot = &d->slots[i];
+
+			if (!slot->stamp || !slot->delay_min ||
+			    !time_before(jiffies,
+					 slot->stamp + CUBIC_DST_LIVE_TIMEOUT))
+				continue;
+			welford_merge(&stats, &slot->stats);
+			if (!delay_min || slot->delay_min < delay_min)
+				delay_min = slot->delay_min;
+		}
+	}
+	if (!delay_min && d->cache_stamp && d->delay_min &&
+	    time_before(jiffies, d->cache_stamp + CUBIC_DST_TIMEOUT)) {
+		stats = d->stats;
+		delay_min = d->delay_min;
+		exit_cwnd = d->exit_cwnd;
+		cached = true;
+	}
+	spin_unlock_bh(&d->lock);
+out:
+	rcu_read_unlock();
+
+	if (!delay_min)
+		return;
+
+	ca->delay_min = delay_min;
+	ca->delay_seeded = cached;
+	if (hystart_sdev_mode != HYSTART_SDEV_ROUND && stats.count) {
+		seed = CUBIC_DST_SEED_COUNT;
+		if (tp->sdev_ewma_shift)
+			seed = min(seed, 1U << tp->sdev_ewma_shift);
+		if (stats.count > seed) {
+			stats.m2 = welford_saturated(&stats) ? U64_MAX :
+				   welford_var(&stats) * seed;
+			stats.count = seed;
+		}
+		tp->sdev_stats = stats;
+	}
+	if (exit_cwnd && tp->snd_ssthresh >= TCP_INFINITE_SSTHRESH)
+		tp->snd_ssthresh = max_t(u32, exit_cwnd, bictcp_low_window(ca));
+}
+
+static void cubic_dst_flush(void)
+{
+	struct cubic_dst *d, *next;
+	unsigned int i;
+
+	for (i = 0; i < ARRAY_SIZE(cubic_dst_hash); i++) {
+		for (d = rcu_dereference_protected(cubic_dst_hash[i], 1); d;
+		     d = next) {
+			next = rcu_dereference_protected(d->next, 1);
+			kfree(d);
+		}
+		RCU_INIT_POINTER(cubic_dst_hash[i], NULL);
+	}
+}
+
+static void cubic_ss_dump(struct sock *sk, u32 cause);
+
 static void bictcp_init(struct sock *sk)
 {
 	struct bictcp *ca = inet_csk_ca(sk);
 
 	bictcp_reset(ca);
-	//printk(KERN_INFO "CUBIC: Current value of hystart_delay_max: %d ", hystart_delay_max);
-	//total_pkts = 0;
+	tcp_sk(sk)->cubic_found = 0;
+	ca->policy = tcp_sk(sk)->cubic_hystart;
+	ca->ss_ring = NULL;
+	ca->ss_recorded = 0;
+	bictcp_sdev_init(sk, bictcp_detect(sk));
+	if (hystart && (hystart_dst_cache || hystart_dst_share))
+		cubic_dst_seed(sk);
 	if (hystart)
 		bictcp_hystart_reset(sk);
 
@@ -163,20 +838,33 @@ static void bictcp_init(struct sock *sk)
 		tcp_sk(sk)->snd_ssthresh = initial_ssthresh;
 }
 
+/* Leave no per-skb RTT sampling, pacing cap or flight recorder behind
+ * for the next congestion control
+ */
+static void bictcp_release(struct sock *sk)
+{
+	cubic_ss_dump(sk, CUBIC_SS_CLOSE);
+	tcp_sk(sk)->rtt_samples = 0;
+	tcp_sk(sk)->pacing_cap = 0;
+}
+
 static void bictcp_cwnd_event(struct sock *sk, enum tcp_ca_event event)
 {
 	if (event == CA_EVENT_TX_START) {
 		struct bictcp *ca = inet_csk_ca(sk);
-		u32 now = tcp_jiffies32;
+		u32 now = bictcp_clock_us(sk);
 		s32 delta;
 
-		delta = now - tcp_sk(sk)->lsndtime;
+		/* lsndtime is in jiffies, so the idle time is too */
+		delta = tcp_jiffies32 - tcp_sk(sk)->lsndtime;
 
 		/* We were application limited (idle) for a while.
 		 * Shift epoch_start to keep cwnd growth to cubic curve.
 		 */
 		if (ca->epoch_start && delta > 0) {
-			ca->epoch_start += delta;
+			ca->epoch_start += min_t(u64, CUBIC_EPOCH_MAX_US,
+						 (u64)jiffies_to_msecs(delta) *
+						 USEC_PER_MSEC);
 			if (after(ca->epoch_start, now))
 				ca->epoch_start = now;
 		}
@@ -232,10 +920,123 @@ static u32 cubic_root(u64 a)
 	return x;
 }
 
+/* calculate floor(sqrt(x)) using a table lookup followed by two
+ * Newton-Raphson iterations and a final correction, which takes at most
+ * one step for x < 2^44 (an RTT deviation of about 4 seconds in usec).
+ */
+static u32 cubic_isqrt(u64 a)
+{
+	u32 b, shift;
+	u64 x;
+	/*
+	 * sqrt(x) << 4 for x in [0..63], rounded to nearest.
+	 */
+	static const u8 v[] = {
+		/* 0x00 */    0,   16,   23,   28,   32,   36,   39,   42,
+		/* 0x08 */   45,   48,   51,   53,   55,   58,   60,   62,
+		/* 0x10 */   64,   66,   68,   70,   72,   73,   75,   77,
+		/* 0x18 */   78,   80,   82,   83,   85,   86,   88,   89,
+		/* 0x20 */   91,   92,   93,   95,   96,   97,   99,  100,
+		/* 0x28 */  101,  102,  104,  105,  106,  107,  109,  110,
+		/* 0x30 */  111,  112,  113,  114,  115,  116,  118,  119,
+		/* 0x38 */  120,  121,  122,  123,  124,  125,  126,  127,
+	};
+
+	b = fls64(a);
+	if (b < 7) {
+		/* a in [0..63] */
+		return v[(u32)a] >> 4;
+	}
+
+	/* Even shift that leaves the top 5 or 6 bits of a as the index */
+	shift = (b - 5) & ~1U;
+	x = ((u64)v[a >> shift] << (shift >> 1)) >> 4;
+
+	/*
+	 * Newton-Raphson iteration
+	 * x    = ( x  +  a / x  ) / 2
+	 *  k+1     k         k
+	 */
+	x = (x + div64_u64(a, x)) >> 1;
+	x = (x + div64_u64(a, x)) >> 1;
+
+	x = min_t(u64, x, U32_MAX);
+	while (x * x > a)
+		x--;
+	while (x < U32_MAX && (x + 1) * (x + 1) <= a)
+		x++;
+	return x;
+}
+
+/* The last CUBIC_SS_RING_SIZE ACKs of slow start.  Allocated on the first
+ * slow start ACK once the tcp_cubic:cubic_ss tracepoint is on (for
+ * SO_DEBUG sockets, or all of them with telemetry=1), emitted through
+ * it and freed when slow start ends, so a connection holds one for at
+ * most one slow start and the steady state pays a NULL test.
+ */
+struct cubic_ss_ring {
+	u64			start_us;	/* tcp_mstamp of the first ACK */
+	u32			count;		/* ACKs recorded */
+	struct cubic_ss_sample	samples[CUBIC_SS_RING_SIZE];
+};
+
+static void cubic_ss_dump(struct sock *sk, u32 cause)
+{
+	struct bictcp *ca = inet_csk_ca(sk);
+	struct cubic_ss_ring *ring = ca->ss_ring;
+	u32 i;
+
+	if (!ring)
+		return;
+
+	ca->ss_ring = NULL;
+	ca->ss_recorded = 1;
+	i = ring->count > CUBIC_SS_RING_SIZE ?
+	    ring->count - CUBIC_SS_RING_SIZE : 0;
+	for (; i < ring->count; i++)
+		trace_cubic_ss(sk, cause, i, ring->count,
+			       &ring->samples[i & (CUBIC_SS_RING_SIZE - 1)]);
+	kfree(ring);
+}
+
+static void cubic_ss_record(struct sock *sk, u32 rtt_us)
+{
+	const struct tcp_sock *tp = tcp_sk(sk);
+	struct bictcp *ca = inet_csk_ca(sk);
+	struct cubic_ss_ring *ring = ca->ss_ring;
+	struct cubic_ss_sample *s;
+
+	if (!tcp_in_slow_start(tp)) {
+		cubic_ss_dump(sk, CUBIC_SS_SSTHRESH);
+		return;
+	}
+
+	if (!ring) {
+		if (ca->ss_recorded || !(telemetry || sock_flag(sk, SOCK_DBG)))
+			return;
+		ring = kmalloc(sizeof(*ring), GFP_ATOMIC);
+		ca->ss_recorded = 1;
+		if (!ring)
+			return;
+		ring->start_us = tp->tcp_mstamp;
+		ring->count = 0;
+		ca->ss_ring = ring;
+	}
+
+	s = &ring->samples[ring->count++ & (CUBIC_SS_RING_SIZE - 1)];
+	s->t_us = tp->tcp_mstamp - ring->start_us;
+	s->rtt_us = rtt_us;
+	s->mean_us = welford_mean(&tp->sdev_stats);
+	s->sdev_us = cubic_isqrt(welford_var(&tp->sdev_stats));
+	s->snd_cwnd = tp->snd_cwnd;
+	s->delivered = tp->delivered;
+}
+
 /*
  * Compute congestion window to use.
  */
-static inline void bictcp_update(struct bictcp *ca, u32 cwnd, u32 acked)
+static inline void bictcp_update(struct bictcp *ca, u32 cwnd, u32 acked,
+				 u32 now)
 {
 	u32 delta, bic_target, max_cnt;
 	u64 offs, t;
@@ -243,21 +1044,21 @@ static inline void bictcp_update(struct bictcp *ca, u32 cwnd, u32 acked)
 	ca->ack_cnt += acked;	/* count the number of ACKed packets */
 
 	if (ca->last_cwnd == cwnd &&
-	    (s32)(tcp_jiffies32 - ca->last_time) <= HZ / 32)
+	    now - ca->last_time <= USEC_PER_SEC / 32)
 		return;
 
-	/* The CUBIC function can update ca->cnt at most once per jiffy.
+	/* The CUBIC function can update ca->cnt at most once per msec.
 	 * On all cwnd reduction events, ca->epoch_start is set to 0,
 	 * which will force a recalculation of ca->cnt.
 	 */
-	if (ca->epoch_start && tcp_jiffies32 == ca->last_time)
+	if (ca->epoch_start && now - ca->last_time < USEC_PER_MSEC)
 		goto tcp_friendliness;
 
 	ca->last_cwnd = cwnd;
-	ca->last_time = tcp_jiffies32;
+	ca->last_time = now;
 
 	if (ca->epoch_start == 0) {
-		ca->epoch_start = tcp_jiffies32;	/* record beginning */
+		ca->epoch_start = now;	/* record beginning */
 		ca->ack_cnt = acked;			/* start counting */
 		ca->tcp_cwnd = cwnd;			/* syn with cubic */
 
@@ -288,11 +1089,16 @@ static inline void bictcp_update(struct bictcp *ca, u32 cwnd, u32 acked)
 	 * if the cwnd < 1 million packets !!!
 	 */
 
-	t = (s32)(tcp_jiffies32 - ca->epoch_start);
-	t += msecs_to_jiffies(ca->delay_min >> 3);
-	/* change the unit from HZ to bictcp_HZ */
+	t = now - ca->epoch_start;
+	/* Saturate rather than let a u32 epoch_start wrap */
+	if (unlikely(t > CUBIC_EPOCH_MAX_US)) {
+		ca->epoch_start = now - CUBIC_EPOCH_MAX_US;
+		t = CUBIC_EPOCH_MAX_US;
+	}
+	t += ca->delay_min;
+	/* change the unit from usec to bictcp_HZ */
 	t <<= BICTCP_HZ;
-	do_div(t, HZ);
+	do_div(t, USEC_PER_SEC);
 
 	if (t < ca->bic_K)		/* t - K */
 		offs = ca->bic_K - t;
@@ -345,7 +1151,12 @@ tcp_friendliness:
 	ca->cnt = max(ca->cnt, 2U);
 }
 
-static void bictcp_cong_avoid(struct sock *sk, u32 ack, u32 acked)
+static __always_inline void hystart_rate_update(struct sock *sk, u32 ack,
+						const int detect);
+static void hystart_exit(struct sock *sk, u32 trigger, u32 thresh);
+
+static __always_inline void __bictcp_cong_avoid(struct sock *sk, u32 ack,
+						u32 acked, const int detect)
 {
 	struct tcp_sock *tp = tcp_sk(sk);
 	struct bictcp *ca = inet_csk_ca(sk);
@@ -354,293 +1165,858 @@ static void bictcp_cong_avoid(struct sock *sk, u32 ack, u32 acked)
 		return;
 
 	if (tcp_in_slow_start(tp)) {
-		if (hystart && after(ack, ca->end_seq))
+		if (hystart)
+			hystart_rate_update(sk, ack, detect);
+		if (hystart && after(ack, ca->end_seq)) {
+			if (hystart_dst_share && cubic_dst_round(sk)) {
+				CUBIC_INC_STATS(CUBIC_MIB_SHAREDEXIT);
+				hystart_exit(sk, HYSTART_SHARED, 0);
+			}
 			bictcp_hystart_reset(sk);
+		}
+		if (unlikely(ca->css_rounds)) {
+			u32 div = max(hystart_css_growth_divisor, 1);
+
+			/* grow by 1/div of slow start, keeping the rest */
+			ca->ack_cnt += acked;
+			acked = ca->ack_cnt / div;
+			ca->ack_cnt -= acked * div;
+		}
 		acked = tcp_slow_start(tp, acked);
 		if (!acked)
 			return;
+		/* cwnd just reached ssthresh */
+		bictcp_sdev_freeze(sk, true);
 	}
-	bictcp_update(ca, tp->snd_cwnd, acked);
+	if (ca->exit_pending &&
+	    tp->snd_cwnd >= HYSTART_PREMATURE_FACTOR * tp->snd_ssthresh) {
+		CUBIC_INC_STATS(CUBIC_MIB_PREMATURE);
+		ca->exit_pending = 0;
+		if (hystart_dst_cache)
+			cubic_dst_premature(sk);
+	}
+	bictcp_update(ca, tp->snd_cwnd, acked, bictcp_clock_us(sk));
 	tcp_cong_avoid_ai(tp, ca->cnt, acked);
 }
 
+/* The burst slow start already put in flight still queues at the
+ * bottleneck after a delay based exit, at the 120% pacing ratio
+ * tcp_update_pacing_rate() applies once cwnd reaches ssthresh.  Cap
+ * pacing at the delivery rate measured at the knee for a few rounds so
+ * that the queue drains instead of overflowing shallow buffers.
+ */
+static void hystart_drain_start(struct sock *sk)
+{
+	struct tcp_sock *tp = tcp_sk(sk);
+	struct bictcp *ca = inet_csk_ca(sk);
+	u64 rate;
+
+	if (!tp->rate_interval_us || tp->rate_app_limited)
+		return;
+
+	rate = (u64)tp->rate_delivered * tp->mss_cache * USEC_PER_SEC;
+	rate = div_u64(rate, tp->rate_interval_us);
+	if (!rate)
+		return;
+
+	tp->pacing_cap = min_t(u64, rate, U32_MAX);
+	ca->drain_rounds = min(hystart_pacing_drain, 3);
+	ca->end_seq = tp->snd_nxt;
+}
+
+/* Pacing holds cwnd back while draining, and tcp_cong_avoid() does not
+ * call cong_avoid for a flow that is not cwnd limited, so drain rounds
+ * are counted from pkts_acked, on every ACK that advances snd_una.
+ */
+static inline void hystart_drain_update(struct sock *sk)
+{
+	struct tcp_sock *tp = tcp_sk(sk);
+	struct bictcp *ca = inet_csk_ca(sk);
+
+	if (!after(tp->snd_una, ca->end_seq))
+		return;
+	if (--ca->drain_rounds)
+		ca->end_seq = tp->snd_nxt;
+	else
+		tp->pacing_cap = 0;
+}
+
+static void hystart_drain_stop(struct sock *sk)
+{
+	struct bictcp *ca = inet_csk_ca(sk);
+
+	if (ca->drain_rounds) {
+		ca->drain_rounds = 0;
+		tcp_sk(sk)->pacing_cap = 0;
+	}
+}
+
 static u32 bictcp_recalc_ssthresh(struct sock *sk)
 {
 	const struct tcp_sock *tp = tcp_sk(sk);
 	struct bictcp *ca = inet_csk_ca(sk);
-    uint16_t s0, s1;
-    uint16_t de0, de1;
-	int port;
-    int desport;
-    int t2;
-	s0 = (tp->inet_conn.icsk_inet.inet_sport & 0x00ff) << 8u;
-	s1 = (tp->inet_conn.icsk_inet.inet_sport & 0xff00) >> 8u;
-	port = s0 | s1;
-    /////////////new changes/////////////////////////////////////////////////////////////////
-    de0 = (tp->inet_conn.icsk_inet.inet_dport & 0x00ff) << 8u;
-	de1 = (tp->inet_conn.icsk_inet.inet_dport & 0xff00) >> 8u;
-	desport = de0 | de1;
+	u32 ssthresh;
 
+	cubic_ss_dump(sk, CUBIC_SS_LOSS);
 	ca->epoch_start = 0;	/* end of epoch */
 
+	if (ca->exit_pending) {
+		u32 elapsed = bictcp_clock_us(sk) - ca->round_start;
+
+		if (elapsed <= (u64)hystart_exit_loss_rtts * (tp->srtt_us >> 3))
+			CUBIC_INC_STATS(CUBIC_MIB_EXITLOSS);
+		ca->exit_pending = 0;
+	}
+	hystart_drain_stop(sk);
+	ca->css_rounds = 0;
+
 	/* Wmax and fast convergence */
 	if (tp->snd_cwnd < ca->last_max_cwnd && fast_convergence)
 		ca->last_max_cwnd = (tp->snd_cwnd * (BICTCP_BETA_SCALE + beta))
 			/ (2 * BICTCP_BETA_SCALE);
 	else
 		ca->last_max_cwnd = tp->snd_cwnd;
-    
-    //printk(KERN_ALERT "CUBIC STATS (%hu, %hu): cwnd2: $%u\n", port, desport, tp->snd_cwnd);
-  //  printk(KERN_ALERT "CUBIC STATS (%hu, %hu): SSthresh2: $%u\n", port, desport, tp->snd_ssthresh);
-    t2 = 1;
-    if (t2 == 1) {
-        if (tp->snd_cwnd >= tp->snd_ssthresh) {
-    		printk(KERN_ALERT "CUBIC INFO(%hu, %hu): EXIT SS with CWIND= %u and SSThRESH= %u \n", port, desport, tp->snd_cwnd, tp->snd_ssthresh);
-        }
-    }
-	return max((tp->snd_cwnd * beta) / BICTCP_BETA_SCALE, 2U);
+
+	bictcp_sdev_freeze(sk, true);
+
+	ssthresh = max((tp->snd_cwnd * beta) / BICTCP_BETA_SCALE, 2U);
+	trace_cubic_ssthresh_recalc(sk, ca->last_max_cwnd, ssthresh);
+	return ssthresh;
 }
 
 static void bictcp_state(struct sock *sk, u8 new_state)
 {
+	struct bictcp *ca = inet_csk_ca(sk);
+
 	if (new_state == TCP_CA_Loss) {
-		bictcp_reset(inet_csk_ca(sk));
+		cubic_ss_dump(sk, CUBIC_SS_LOSS);
+		hystart_drain_stop(sk);
+		bictcp_reset(ca);
+		tcp_sk(sk)->cubic_found = 0;
 		bictcp_hystart_reset(sk);
+		/* back to slow start from cwnd 1 */
+		bictcp_sdev_freeze(sk, !hystart || ca->sdev_off);
 	}
 }
 
-static void hystart_update(struct sock *sk, u32 delay)
+/* Deviation of the RTT samples, from the estimator hystart_sdev_mode selects */
+static u32 hystart_rtt_sdev(const struct sock *sk)
+{
+	return cubic_isqrt(welford_var(&tcp_sk(sk)->sdev_stats));
+}
+
+/* Margin above delay_min that counts as a delay increase (usec) */
+static inline u32 hystart_delay_margin(const struct sock *sk,
+				       const struct bictcp *ca,
+				       const int sdev_mode)
+{
+	if (sdev_mode == HYSTART_SDEV_OFF)
+		return HYSTART_DELAY_THRESH(ca, ca->delay_min >> 3);
+
+	return HYSTART_DELAY_THRESH(ca, hystart_rtt_sdev(sk));
+}
+
+/* Margin of the HYSTART_DELAY_SDEV trigger: k * sdev (usec) */
+static u32 hystart_sdev_margin(const struct sock *sk)
+{
+	u64 margin;
+
+	margin = ((u64)hystart_rtt_sdev(sk) * hystart_sdev_k) >>
+		 HYSTART_SDEV_K_SHIFT;
+	return clamp_t(u64, margin, hystart_sdev_min, hystart_sdev_max);
+}
+
+/* Smallest histogram shift whose top bucket, at 2^(shift + 7), still
+ * lies above the margin: delay_min / 8 within the HYSTART_DELAY_THRESH
+ * clamps, or up to hystart_sdev_max once a deviation feeds the margins.
+ */
+static u32 hystart_hist_shift(const struct bictcp *ca, const int detect,
+			      const int sdev_mode)
+{
+	u32 margin = HYSTART_DELAY_THRESH(ca, ca->delay_min >> 3);
+
+	if ((detect & HYSTART_DELAY_SDEV) || sdev_mode != HYSTART_SDEV_OFF)
+		margin = max_t(u32, margin, hystart_sdev_max);
+	return clamp_t(int, fls(margin) - (HYSTART_HIST_BUCKETS - 1) / 2,
+		       HYSTART_HIST_BASE_SHIFT, HYSTART_HIST_SHIFT_MAX);
+}
+
+static u32 hystart_hist_bucket(u32 excess, u32 shift)
+{
+	u32 octave, bucket;
+
+	if (excess < (1U << shift))
+		return 0;
+
+	octave = fls(excess) - 1 - shift;
+	/* the upper half of an octave starts at 2^octave * sqrt(2) */
+	bucket = 1 + 2 * octave +
+		 (excess >= (((u64)181 << octave) << shift) >> 7);
+	return min_t(u32, bucket, HYSTART_HIST_BUCKETS - 1);
+}
+
+/* Lower edge of a bucket, i.e. the smallest excess it holds */
+static u32 hystart_hist_edge(u32 bucket, u32 shift)
+{
+	u64 edge;
+
+	if (!bucket)
+		return 0;
+
+	edge = (1ULL << shift) << ((bucket - 1) >> 1);
+	if (!(bucket & 1))
+		edge = (edge * 181) >> 7;
+	return edge;
+}
+
+/* Count a delay sample; a full counter halves them all */
+static void hystart_hist_add(struct bictcp *ca, u32 delay)
+{
+	u32 shift = hystart_hist_bucket(delay - ca->delay_min,
+					HYSTART_HIST_BASE_SHIFT +
+					ca->hist_shift) * 4;
+
+	if (((ca->rtt_hist >> shift) & HYSTART_HIST_NIBBLE_MAX) ==
+	    HYSTART_HIST_NIBBLE_MAX)
+		ca->rtt_hist = (ca->rtt_hist >> 1) & 0x7777777777777777ULL;
+	ca->rtt_hist += 1ULL << shift;
+}
+
+/* Excess delay at percentile pct of this round's samples */
+static u32 hystart_hist_percentile(const struct bictcp *ca, u32 pct)
+{
+	u32 i, total = 0, rank, sum = 0;
+
+	for (i = 0; i < HYSTART_HIST_BUCKETS; i++)
+		total += (ca->rtt_hist >> (i * 4)) & HYSTART_HIST_NIBBLE_MAX;
+
+	rank = max_t(u32, DIV_ROUND_UP(total * pct, 100), 1);
+	for (i = 0; i < HYSTART_HIST_BUCKETS - 1; i++) {
+		sum += (ca->rtt_hist >> (i * 4)) & HYSTART_HIST_NIBBLE_MAX;
+		if (sum >= rank)
+			break;
+	}
+	return hystart_hist_edge(i, HYSTART_HIST_BASE_SHIFT + ca->hist_shift);
+}
+
+/* A percentile curr_rtt is at most delay_min plus the top bucket's edge,
+ * so keep a margin above that, which hystart_hist_shift() could not
+ * cover, just below it: the trigger fires once the round sits in the
+ * top bucket rather than never.
+ */
+static inline u32 hystart_hist_margin(const struct bictcp *ca, u32 margin)
+{
+	if (!hystart_rtt_percentile)
+		return margin;
+	return min(margin, hystart_hist_edge(HYSTART_HIST_BUCKETS - 1,
+					     HYSTART_HIST_BASE_SHIFT +
+					     ca->hist_shift) - 1);
+}
+
+/* The registered exit predicate, behind a static key so that CUBIC
+ * pays nothing for the hook until a module registers one.
+ */
+static struct cubic_hystart_ops __rcu *cubic_hystart_custom;
+static DEFINE_STATIC_KEY_FALSE(cubic_hystart_key);
+static DEFINE_MUTEX(cubic_hystart_mutex);
+
+int cubic_hystart_register(struct cubic_hystart_ops *ops)
+{
+	int ret = 0;
+
+	if (!ops->exit)
+		return -EINVAL;
+
+	mutex_lock(&cubic_hystart_mutex);
+	if (rcu_dereference_protected(cubic_hystart_custom,
+				      lockdep_is_held(&cubic_hystart_mutex))) {
+		ret = -EBUSY;
+	} else {
+		rcu_assign_pointer(cubic_hystart_custom, ops);
+		static_branch_enable(&cubic_hystart_key);
+	}
+	mutex_unlock(&cubic_hystart_mutex);
+	return ret;
+}
+EXPORT_SYMBOL_GPL(cubic_hystart_register);
+
+/* After this returns no socket is still inside ops->exit() */
+void cubic_hystart_unregister(struct cubic_hystart_ops *ops)
+{
+	mutex_lock(&cubic_hystart_mutex);
+	if (rcu_dereference_protected(cubic_hystart_custom,
+				      lockdep_is_held(&cubic_hystart_mutex)) ==
+	    ops) {
+		static_branch_disable(&cubic_hystart_key);
+		RCU_INIT_POINTER(cubic_hystart_custom, NULL);
+	}
+	mutex_unlock(&cubic_hystart_mutex);
+	synchronize_rcu();
+}
+EXPORT_SYMBOL_GPL(cubic_hystart_unregister);
+
+static int hystart_custom(struct sock *sk, u32 delay)
+{
+	const struct tcp_sock *tp = tcp_sk(sk);
+	const struct bictcp *ca = inet_csk_ca(sk);
+	const struct cubic_hystart_ops *ops;
+	int ret = CUBIC_HYSTART_DEFAULT;
+
+	rcu_read_lock();
+	ops = rcu_dereference(cubic_hystart_custom);
+	if (ops) {
+		const struct cubic_hystart_ctx ctx = {
+			.sk			= sk,
+			.delay_us		= delay,
+			.curr_rtt_us		= ca->curr_rtt,
+			.delay_min_us		= ca->delay_min,
+			.mean_us		= welford_mean(&tp->sdev_stats),
+			.var_us2		= welford_var(&tp->sdev_stats),
+			.sample_cnt		= ca->sample_cnt,
+			.round_us		= bictcp_clock_us(sk) -
+						  ca->round_start,
+			.snd_cwnd		= tp->snd_cwnd,
+			.rate_delivered		= tp->rate_delivered,
+			.rate_interval_us	= tp->rate_interval_us,
+		};
+
+		ret = ops->exit(&ctx);
+	}
+	rcu_read_unlock();
+	return ret;
+}
+
+/* Receivers aggregate ACKs (GRO, interrupt mitigation), which at usec
+ * resolution shows up in the ACK train of short RTT flows once cwnd has
+ * grown past small packet trains.  Allow for the time two full TSO
+ * packets take at the pacing rate, at most 1 ms.
+ */
+static u32 hystart_ack_delay(const struct sock *sk)
+{
+	u32 rate = READ_ONCE(sk->sk_pacing_rate);
+
+	if (!rate)
+		return 0;
+	return min_t(u64, USEC_PER_MSEC,
+		     div_u64((u64)GSO_MAX_SIZE * 4 * USEC_PER_SEC, rate));
+}
+
+static inline bool hystart_checkpoint(u32 cnt)
+{
+	return cnt >= HYSTART_MIN_SAMPLES && cnt <= HYSTART_EVAL_MAX &&
+	       !(cnt & (cnt - 1));
+}
+
+/* Leave slow start at the current cwnd */
+static void hystart_exit(struct sock *sk, u32 trigger, u32 thresh)
 {
 	struct tcp_sock *tp = tcp_sk(sk);
 	struct bictcp *ca = inet_csk_ca(sk);
-	//uint16_t b0, b1;
-	//int port;
-        //b0 = (tp->inet_conn.icsk_inet.inet_sport & 0x00ff) << 8u;
-	//b1 = (tp->inet_conn.icsk_inet.inet_sport & 0xff00) >> 8u;
-	//port = b0 | b1;
-	//printk(KERN_INFO "CUBIC: in hystart_update");	
-	//printk(KERN_INFO "CUBIC (%hu): Sample count: $%d\n", port, ca->sample_cnt);
-	//printk(KERN_INFO "CUBIC STAT: Delay: %d\n", (delay >> 3));
-	//printk(KERN_INFO "CUBIC (%hu): curr RTT: $%d\n", port, (ca->curr_rtt >> 3));
-	//printk(KERN_INFO "CUBIC (%hu): min RTT: $%d\n", port, (ca->delay_min >> 3));
-	//printk(KERN_INFO "CUBIC (%hu): delay thresh: $%d\n", port, (HYSTART_DELAY_THRESH(ca->delay_min >> 3) >> 3));
-
-	if (ca->found & hystart_detect)
+
+	ca->found |= trigger;
+	tp->cubic_found = ca->found;
+	tp->snd_ssthresh = tp->snd_cwnd;
+	ca->css_rounds = 0;
+	ca->exit_pending = 1;
+	ca->round_start = bictcp_clock_us(sk);
+	bictcp_sdev_freeze(sk, true);
+	if (hystart_pacing_drain &&
+	    (trigger & (HYSTART_DELAY | HYSTART_DELAY_SDEV)))
+		hystart_drain_start(sk);
+	if (hystart_dst_cache || hystart_dst_share)
+		cubic_dst_store(sk, trigger);
+	trace_cubic_hystart_exit(sk, trigger, ca->delay_min, ca->curr_rtt,
+				 thresh);
+	cubic_ss_dump(sk, CUBIC_SS_EXIT);
+}
+
+/* A delay trigger ends slow start */
+static void hystart_delay_exit(struct sock *sk, u32 trigger, u32 thresh)
+{
+	struct tcp_sock *tp = tcp_sk(sk);
+
+	NET_INC_STATS(sock_net(sk), LINUX_MIB_TCPHYSTARTDELAYDETECT);
+	NET_ADD_STATS(sock_net(sk), LINUX_MIB_TCPHYSTARTDELAYCWND,
+		      tp->snd_cwnd);
+	if (trigger == HYSTART_DELAY_SDEV) {
+		CUBIC_INC_STATS(CUBIC_MIB_SDEVDETECT);
+		CUBIC_ADD_STATS(CUBIC_MIB_SDEVCWND, tp->snd_cwnd);
+	}
+	hystart_exit(sk, trigger, thresh);
+}
+
+/* A delay trigger fired.  With hystart_css_rounds, rather than leave
+ * slow start at once, grow at 1/hystart_css_growth_divisor of the slow
+ * start rate for that many rounds, as HyStart++ does: a round whose RTT
+ * is back under the trigger's threshold shows the spike was jitter and
+ * resumes full slow start, with no loss taken to find that out.
+ */
+static void hystart_delay_found(struct sock *sk, u32 trigger, u32 thresh)
+{
+	struct bictcp *ca = inet_csk_ca(sk);
+
+	if (!hystart_css_rounds) {
+		hystart_delay_exit(sk, trigger, thresh);
 		return;
+	}
 
-	if (hystart_detect & HYSTART_ACK_TRAIN) {
-		u32 now = bictcp_clock();
+	ca->css_rounds = clamp(hystart_css_rounds, 1, HYSTART_CSS_ROUNDS_MAX);
+	ca->css_sdev = trigger == HYSTART_DELAY_SDEV;
+	ca->ack_cnt = 0;
+	CUBIC_INC_STATS(CUBIC_MIB_CSSENTER);
+}
+
+/* Once per CSS round, when curr_rtt has enough samples */
+static void hystart_css_update(struct sock *sk, u32 thresh)
+{
+	struct bictcp *ca = inet_csk_ca(sk);
+
+	if (ca->curr_rtt <= thresh) {
+		ca->css_rounds = 0;
+		CUBIC_INC_STATS(CUBIC_MIB_CSSRESUME);
+	} else if (!--ca->css_rounds) {
+		hystart_delay_exit(sk, ca->css_sdev ? HYSTART_DELAY_SDEV :
+						      HYSTART_DELAY, thresh);
+	}
+}
+
+static __always_inline void hystart_update(struct sock *sk, u32 delay,
+					   const int detect, const int sdev_mode)
+{
+	struct tcp_sock *tp = tcp_sk(sk);
+	struct bictcp *ca = inet_csk_ca(sk);
+	u32 thresh;
+
+	if (ca->found & detect)
+		return;
+
+	if (detect & HYSTART_ACK_TRAIN) {
+		u32 now = bictcp_clock_us(sk);
 
 		/* first detection parameter - ack-train detection */
-		if ((s32)(now - ca->last_ack) <= hystart_ack_delta) {
+		if ((s32)(now - ca->last_ack) <= bictcp_ack_delta_us(ca)) {
 			ca->last_ack = now;
-			if ((s32)(now - ca->round_start) > ca->delay_min >> 4) {
-				ca->found |= HYSTART_ACK_TRAIN;
+			thresh = ca->delay_min + hystart_ack_delay(sk);
+			/* the train normally triggers past delay_min / 2,
+			 * but pacing may have spread slow start's packets
+			 * over up to half an RTT
+			 */
+			if (sk->sk_pacing_status == SK_PACING_NONE)
+				thresh >>= 1;
+			if (now - ca->round_start > thresh) {
 				NET_INC_STATS(sock_net(sk),
 				      LINUX_MIB_TCPHYSTARTTRAINDETECT);
 				NET_ADD_STATS(sock_net(sk),
 					      LINUX_MIB_TCPHYSTARTTRAINCWND,
 					      tp->snd_cwnd);
-				tp->snd_ssthresh = tp->snd_cwnd;
+				hystart_exit(sk, HYSTART_ACK_TRAIN, thresh);
+				return;
 			}
 		}
 	}
 
-	if (hystart_detect & HYSTART_DELAY) {
-		// printk(KERN_INFO "CUBIC: Looking at delays");
-		// printk(KERN_INFO "CUBIC: Current value of hystart_delay_max: %d", hystart_delay_max);
-		// printk(KERN_INFO "CUBIC: Current value of ca->sample_cnt: %d", ca->sample_cnt);
-		/* obtain the minimum delay of more than sampling packets */
-		if (ca->curr_rtt > delay)
-			ca->curr_rtt = delay;
-		if (ca->sample_cnt < HYSTART_MIN_SAMPLES) {
-			// printk(KERN_INFO "CUBIC: Sample count less than min samples");
-			if (ca->curr_rtt == 0 || ca->curr_rtt > delay)
-				ca->curr_rtt = delay;
+	if (!(detect & HYSTART_DELAY_ANY))
+		return;
 
-			ca->sample_cnt++;
-		} else {
-			//printk(KERN_INFO "CUBIC EVENT (%hu): Evaluating delay increase and resetting\n", port);
-			// printk(KERN_INFO "CUBIC: Current min RTT is: %d\n", ca->delay_min);
-			// printk(KERN_INFO "CUBIC: Current value of HYSTART_DELAY_THRESH: %d\n", HYSTART_DELAY_THRESH(ca->delay_min >> 3));
-			if (ca->curr_rtt > ca->delay_min +
-			    HYSTART_DELAY_THRESH(ca->delay_min >> 3)) {
-				//printk(KERN_INFO "CUBIC (%hu): Exit due to delay detect\n", port);
-				ca->found |= HYSTART_DELAY;
-				NET_INC_STATS(sock_net(sk),
-					      LINUX_MIB_TCPHYSTARTDELAYDETECT);
-				NET_ADD_STATS(sock_net(sk),
-					      LINUX_MIB_TCPHYSTARTDELAYCWND,
-					      tp->snd_cwnd);
-				tp->snd_ssthresh = tp->snd_cwnd;
-			}
+	/* Every ACK only folds its sample into the round's accumulators;
+	 * the thresholds, which cost a divide and a square root with the
+	 * sdev estimators, are only evaluated at the checkpoints.
+	 */
+	if (hystart_rtt_percentile) {
+		if (!ca->sample_cnt)
+			ca->hist_shift = hystart_hist_shift(ca, detect,
+							    sdev_mode) -
+					 HYSTART_HIST_BASE_SHIFT;
+		hystart_hist_add(ca, delay);
+	} else if (ca->sample_cnt < HYSTART_MIN_SAMPLES &&
+		   (ca->curr_rtt == 0 || ca->curr_rtt > delay)) {
+		/* classic HyStart's minimum, of the first samples only */
+		ca->curr_rtt = delay;
+	}
+	if (ca->sample_cnt < U8_MAX)
+		ca->sample_cnt++;
+	if (!hystart_checkpoint(ca->sample_cnt))
+		return;
+
+	if (hystart_rtt_percentile)
+		ca->curr_rtt = ca->delay_min +
+			hystart_hist_percentile(ca,
+				clamp(hystart_rtt_percentile, 1, 100));
+
+	if ((detect & HYSTART_CUSTOM) &&
+	    static_branch_unlikely(&cubic_hystart_key)) {
+		switch (hystart_custom(sk, delay)) {
+		case CUBIC_HYSTART_EXIT:
+			hystart_exit(sk, HYSTART_CUSTOM, 0);
+			return;
+		case CUBIC_HYSTART_CONTINUE:
+			return;
+		}
+	}
+
+	if (unlikely(ca->css_rounds)) {
+		if (ca->sample_cnt == HYSTART_MIN_SAMPLES) {
+			thresh = ca->delay_min +
+				 hystart_hist_margin(ca, ca->css_sdev ?
+					hystart_sdev_margin(sk) :
+					hystart_delay_margin(sk, ca, sdev_mode));
+			hystart_css_update(sk, thresh);
+		}
+		return;
+	}
+
+	if (detect & HYSTART_DELAY) {
+		thresh = ca->delay_min +
+			 hystart_hist_margin(ca, hystart_delay_margin(sk, ca,
+								      sdev_mode));
+		if (ca->sample_cnt == HYSTART_MIN_SAMPLES)
+			trace_cubic_hystart_sample(sk, HYSTART_DELAY,
+				ca->delay_min, ca->curr_rtt, thresh);
+		if (ca->curr_rtt > thresh) {
+			hystart_delay_found(sk, HYSTART_DELAY, thresh);
+			return;
+		}
+	}
+
+	if (detect & HYSTART_DELAY_SDEV) {
+		thresh = ca->delay_min +
+			 hystart_hist_margin(ca, hystart_sdev_margin(sk));
+		if (ca->sample_cnt == HYSTART_MIN_SAMPLES)
+			trace_cubic_hystart_sample(sk, HYSTART_DELAY_SDEV,
+				ca->delay_min, ca->curr_rtt, thresh);
+		if (ca->curr_rtt > thresh) {
+			hystart_delay_found(sk, HYSTART_DELAY_SDEV, thresh);
+			return;
 		}
 	}
 }
 
+/* Bandwidth plateau detection.  Called from cong_avoid, after
+ * tcp_rate_gen() has refreshed tp->rate_delivered and rate_interval_us
+ * (pkts_acked runs too early for that).  Each round keeps its best
+ * non-app-limited delivery rate; once hystart_rate_rounds rounds in a
+ * row fail to beat full_rate by hystart_rate_growth percent, the
+ * bottleneck is full.
+ */
+static __always_inline void hystart_rate_update(struct sock *sk, u32 ack,
+						const int detect)
+{
+	struct tcp_sock *tp = tcp_sk(sk);
+	struct bictcp *ca = inet_csk_ca(sk);
+	u64 rate;
+
+	if (!(detect & HYSTART_RATE) || (ca->found & detect) ||
+	    tp->snd_cwnd < bictcp_low_window(ca))
+		return;
+
+	if (!tp->rate_app_limited && tp->rate_interval_us) {
+		rate = div_u64((u64)tp->rate_delivered << HYSTART_RATE_SCALE,
+			       tp->rate_interval_us);
+		ca->round_rate = max_t(u64, ca->round_rate,
+				       min_t(u64, rate, U32_MAX));
+	}
+
+	/* evaluate at the end of each round that produced a sample */
+	if (!after(ack, ca->end_seq) || !ca->round_rate)
+		return;
+
+	rate = (u64)ca->full_rate * (100 + hystart_rate_growth);
+	if ((u64)ca->round_rate * 100 >= rate) {
+		ca->full_rate = ca->round_rate;
+		ca->rate_rounds = 0;
+		return;
+	}
+
+	/* rate_rounds is a 2-bit counter */
+	if (++ca->rate_rounds >= clamp(hystart_rate_rounds, 1, 3)) {
+		NET_INC_STATS(sock_net(sk), LINUX_MIB_TCPHYSTARTTRAINDETECT);
+		NET_ADD_STATS(sock_net(sk), LINUX_MIB_TCPHYSTARTTRAINCWND,
+			      tp->snd_cwnd);
+		CUBIC_INC_STATS(CUBIC_MIB_RATEDETECT);
+		CUBIC_ADD_STATS(CUBIC_MIB_RATECWND, tp->snd_cwnd);
+		hystart_exit(sk, HYSTART_RATE, 0);
+	}
+}
+
 /* Track delayed acknowledgment ratio using sliding window
  * ratio = (15*ratio + sample) / 16
  */
-static void bictcp_acked(struct sock *sk, const struct ack_sample *sample)
+static __always_inline void __bictcp_acked(struct sock *sk,
+					   const struct ack_sample *sample,
+					   const int detect,
+					   const int sdev_mode)
 {
-	const struct tcp_sock *tp = tcp_sk(sk);
+	struct tcp_sock *tp = tcp_sk(sk);
 	struct bictcp *ca = inet_csk_ca(sk);
-    //const struct rate_sample *rs; 
 	u32 delay;
-	uint16_t b0, b1;
-    uint16_t d0, d1;
-	int port;
-    int desport;
-    int t;
-	long long variance;
-	long sdev;
-	u32 start;
-	u64 mid;
-	u64 end;
-	static u32 rtt_sdev_ms = 0;
+
+	if (unlikely(ca->drain_rounds))
+		hystart_drain_update(sk);
+
 	/* Some calls are for duplicates without timetamps */
 	if (sample->rtt_us < 0)
 		return;
 
+	/* The RTT statistics are CUBIC's own, so they are fed from here
+	 * rather than from tcp_rtt_estimator() and other congestion
+	 * controls pay nothing for them.  A stretch or coalesced ACK
+	 * stands for every packet it covers, merged in one step.  With
+	 * tp->rtt_samples, tcp_clean_rtx_queue() has already merged the
+	 * RTT of each skb this ACK covered.
+	 */
+	if (!tp->sdev_frozen && !tp->rtt_samples)
+		welford_update_ewma_n(&tp->sdev_stats, sample->rtt_us,
+				      sample->pkts_acked, tp->sdev_ewma_shift);
+	if (unlikely(welford_saturated(&tp->sdev_stats)) &&
+	    !ca->sdev_saturated) {
+		CUBIC_INC_STATS(CUBIC_MIB_SDEVSATURATED);
+		ca->sdev_saturated = 1;
+	}
+
+	if (unlikely(ca->ss_ring) || trace_cubic_ss_enabled())
+		cubic_ss_record(sk, sample->rtt_us);
+
 	/* Discard delay samples right after fast recovery */
-	if (ca->epoch_start && (s32)(tcp_jiffies32 - ca->epoch_start) < HZ)
+	if (ca->epoch_start &&
+	    bictcp_clock_us(sk) - ca->epoch_start < USEC_PER_SEC)
 		return;
 
-	delay = (sample->rtt_us << 3) / USEC_PER_MSEC;
+	/* Per-ACK telemetry goes to the tcp_cubic:cubic_acked tracepoint,
+	 * which is a static branch until enabled through tracefs.
+	 */
+	if (trace_cubic_acked_enabled() &&
+	    (telemetry || sock_flag(sk, SOCK_DBG))) {
+		u64 variance = welford_var(&tp->sdev_stats);
+
+		trace_cubic_acked(sk, sample->rtt_us, sample->pkts_acked,
+				  variance, cubic_isqrt(variance));
+	}
+
+	delay = sample->rtt_us;
 	if (delay == 0)
 		delay = 1;
-	
-	if (tp->sdev_stats.num_packets > 0){
-		// Convert M2 into varinace in MS
-		variance = (tp->sdev_stats.m2_rtt_ms / tp->sdev_stats.num_packets);
-	}else{
-		variance  = 0;
-	}
-	if (variance == 0 || variance == 1){
-		sdev = variance;
-	}else if (variance < 0){
-		printk(KERN_INFO "CUBIC WARNING: varinace was measured to be negative");
-	}else{
-		// Do Binary Search for floor(sqrt(variance))
-		start = 1;
-		end = variance >> 1;
-		while (start <= end) {
-			
-			//if (rtt_sdev_ms){
-			//	mid = rtt_sdev_ms;
-			//	rtt_sdev_ms = 0;
-			//} else{
-				mid = (start + end) >> 1;
-			//}
-			
-			// If x is a perfect square
-			if (mid * mid == variance){
-				sdev = mid;
-				break;
-			}
-			// if variance is larger than mid*mid move towards the sqrt of variance
-			if(mid <= variance / mid){
-				start = mid+1;
-				sdev = mid;
-			}else{ 
-				// If mid*mid is greater than x
-				end = mid - 1;
-			}
-    		}
-		//printk(KERN_INFO "CUBIC STATS (%hu): Start: $%d", port, start);
-		//printk(KERN_INFO "CUBIC STATS (%hu): M2: $%lld", port, tp->sdev_stats.m2_rtt_us);
-	}
-	rtt_sdev_ms = sdev;
-
-	// printk(KERN_INFO "CUBIC: current value of ca->found %d", ca->found);
-	b0 = (tp->inet_conn.icsk_inet.inet_sport & 0x00ff) << 8u;
-	b1 = (tp->inet_conn.icsk_inet.inet_sport & 0xff00) >> 8u;
-	port = b0 | b1;
-    /////////////new changes/////////////////////////////////////////////////////////////////
-    d0 = (tp->inet_conn.icsk_inet.inet_dport & 0x00ff) << 8u;
-	d1 = (tp->inet_conn.icsk_inet.inet_dport & 0xff00) >> 8u;
-	desport = d0 | d1;
-    
-    t = 1;
-
-    if (t == 1) {
-        ///////////////////////////////////////////////////////////////////////////////////////
-	    //printk(KERN_INFO "CUBIC (%hu): packets since start: $%d\n", port, total_pkts++);
-        //printk(KERN_INFO "CUBIC STATS (%hu): M2: $%lld", port, (tp->sdev_stats.m2_rtt_ns / (USEC_PER_MSEC * USEC_PER_MSEC)));
-        //printk(KERN_INFO "CUBIC STATS (%hu): packets in flight: $%d\n", port, tp->packets_out);
-        //printk(KERN_INFO "CUBIC (%hu): Sample count: $%d\n", port, ca->sample_cnt);
-    	//printk(KERN_INFO "CUBIC (%hu): curr RTT: $%d\n", port, (ca->curr_rtt >> 3));
-    	//printk(KERN_INFO "CUBIC (%hu): min RTT: $%d\n", port, (ca->delay_min >> 3));
-    	//printk(KERN_INFO "CUBIC (%hu): delay thresh: $%d\n", port, (HYSTART_DELAY_THRESH(ca->delay_min >> 3) >> 3));
-    	//printk(KERN_INFO "CUBIC (%hu): Smoothed RTT: $%ld\n", port, (tp->srtt_us/USEC_PER_MSEC));
-    	//printk(KERN_INFO "CUBIC (%hu): Smoothed mdev: $%ld\n", port, (tp->rttvar_us/USEC_PER_MSEC));
-    	//printk(KERN_INFO "CUBIC (%hu): Max mdev: $%ld\n", port, (tp->mdev_max_us/USEC_PER_MSEC));
-    	printk(KERN_INFO "CUBIC STATS (%hu, %hu): sample RTT: $%ld\n", port, desport, (sample->rtt_us / USEC_PER_MSEC));
-    	printk(KERN_INFO "CUBIC STATS (%hu, %hu): Running avg: $%ld", port, desport, (tp->sdev_stats.mean_rtt_us / USEC_PER_MSEC));
-    	printk(KERN_INFO "CUBIC STATS (%hu, %hu): sdev: $%ld\n", port, desport, (sdev));
-    	printk(KERN_INFO "CUBIC STATS (%hu, %hu): variance: $%lld\n", port, desport, (variance));
-    	printk(KERN_INFO "CUBIC STATS (%hu, %hu): count: $%ld\n", port, desport, tp->sdev_stats.num_packets);
-    	printk(KERN_INFO "CUBIC STATS (%hu, %hu): m2: $%lld\n", port, desport, tp->sdev_stats.m2_rtt_ms);
-    	printk(KERN_INFO "CUBIC STATS (%hu, %hu): cwnd: $%u\n", port, desport, tp->snd_cwnd);
-        /////////////new changes/////////////////////////////////////////////////////////////////
-        printk(KERN_INFO "CUBIC STATS (%hu, %hu): SSthresh: $%u\n", port, desport, tp->snd_ssthresh);
-        /////////////////////////////////////////////////////////////////////////////////////////
-    	printk(KERN_INFO "CUBIC STATS (%hu, %hu): pkts_acked: $%d\n", port, desport, sample->pkts_acked);
-    	printk(KERN_INFO "CUBIC STATS (%hu, %hu): mss: $%d\n", port, desport, tp->mss_cache);
-        printk(KERN_INFO "CUBIC (%hu, %hu): Medium Deviation: $%ld\n", port, desport, (tp->mdev_us/ USEC_PER_MSEC));
-        /////////////new changes/////////////////////////////////////////////////////////////////
-        printk(KERN_INFO "CUBIC STATS (%hu, %hu): pkt_loss: $%u\n", port, desport, tp->lost_out);
-        printk(KERN_INFO "CUBIC STATS (%hu, %hu): retrans_seg: $%u\n", port, desport, tp->retrans_out);
-        printk(KERN_INFO "CUBIC STATS (%hu, %hu): Bytes-sent: $%llu\n", port, desport, tp->bytes_sent);
-        printk(KERN_INFO "CUBIC STATS (%hu, %hu): Bytes-acked: $%llu\n", port, desport, tp->bytes_acked);
-        //printk(KERN_INFO "CUBIC STATS (%hu, %hu): seq_num: $%u\n", port, desport, tp->data_segs_out);
-        printk(KERN_INFO "CUBIC STATS (%hu, %hu): seq_num2: $%u\n", port, desport, tp->snd_nxt);
-        printk(KERN_INFO "CUBIC STATS (%hu, %hu): delivery_rate: $%u\n", port, desport, tp->rate_delivered);
-        //printk(KERN_INFO "CUBIC STATS (%hu, %hu): delivery_rate: $%u\n", port, desport, rs->delivered);
-        printk(KERN_INFO "CUBIC STATS (%hu, %hu): deliveredpkts: $%u\n", port, desport, tp->delivered);
-        printk(KERN_INFO "CUBIC STATS (%hu, %hu): packets in flight: $%d\n", port, desport, tp->packets_out);   
-        printk(KERN_INFO "CUBIC STATS (%hu, %hu): sackedout: $%u\n", port, desport, tp->sacked_out);
-        printk(KERN_INFO "CUBIC STATS (%hu, %hu): sequence-of-ack: $%u\n", port, desport, tp->pushed_seq);
-	    printk(KERN_INFO "CUBIC STATS (%hu, %hu): The end: $%u //////////////////////////////////////\n", port, desport, tp->snd_una);
-
-        if (tcp_in_slow_start(tp))
-    	    printk(KERN_INFO "CUBIC INFO(%hu, %hu): In slow start with CWIND= %u and SSThRESH= %u\n", port, desport, tp->snd_cwnd, tp->snd_ssthresh);
-   
-    }
-        /////////////////////////////////////////////////////////////////////////////////////////
-    if (tp->snd_cwnd >= tp->snd_ssthresh) {
-    		printk(KERN_INFO "CUBIC INFO(%hu, %hu): Exit slow start with CWIND= %u and SSThRESH= %u \n", port, desport, tp->snd_cwnd, tp->snd_ssthresh);
-    }   
-    
-    
-    
-	//if (ca->found == 2)
-	//	printk(KERN_INFO "CUBIC (%hu): Exit due to delay detect\n", port);
-	//printk(KERN_INFO "CUBIC STATS: sport: %hu\n", port);
+
+	/* first time call or link delay decreases */
+	if (ca->delay_min == 0 || ca->delay_min > delay ||
+	    unlikely(ca->delay_seeded)) {
+		ca->delay_min = delay;
+		ca->delay_seeded = 0;
+	}
+
 	/* hystart triggers when cwnd is larger than some threshold */
 	if (hystart && tcp_in_slow_start(tp) &&
-         tp->snd_cwnd >= hystart_low_window){
-		//printk(KERN_INFO "CUBIC: sample RTT: %ld\n", (sample->rtt_us / USEC_PER_MSEC));
-		//printk(KERN_INFO "CUBIC: socket RTT: %d\n", (ca->curr_rtt));
-		hystart_update(sk, delay);
+	    tp->snd_cwnd >= bictcp_low_window(ca))
+		hystart_update(sk, delay, detect, sdev_mode);
+}
+
+/* Extract info for Tcp socket info provided via netlink: the RTT
+ * statistics HyStart works from and how slow start ended, as a
+ * tcp_cubic_info record.  Like BBR, answer a request for the Vegas
+ * record, as the 8-bit idiag_ext of INET_DIAG requests has no bit for
+ * INET_DIAG_CUBICINFO.
+ */
+static size_t bictcp_get_info(struct sock *sk, u32 ext, int *attr,
+			      union tcp_cc_info *info)
+{
+	const struct tcp_sock *tp = tcp_sk(sk);
+	const struct bictcp *ca = inet_csk_ca(sk);
+	struct tcp_cubic_info *ci = (struct tcp_cubic_info *)info;
+	u64 var;
+
+	if (ext & (1 << (INET_DIAG_VEGASINFO - 1))) {
+		var = welford_var(&tp->sdev_stats);
+		memset(ci, 0, sizeof(*ci));
+		ci->cubic_enabled = !!hystart;
+		ci->cubic_found = ca->found;
+		ci->cubic_mean = welford_mean(&tp->sdev_stats);
+		ci->cubic_var = min_t(u64, var, U32_MAX);
+		ci->cubic_sdev = cubic_isqrt(var);
+		ci->cubic_curr_rtt = ca->curr_rtt;
+		ci->cubic_delay_min = ca->delay_min;
+
+		*attr = INET_DIAG_CUBICINFO;
+		return sizeof(*ci);
 	}
+	return 0;
+}
+
+#ifdef CONFIG_PROC_FS
+static const struct snmp_mib cubic_mib_list[] = {
+	SNMP_MIB_ITEM("HyStartSdevDetect", CUBIC_MIB_SDEVDETECT),
+	SNMP_MIB_ITEM("HyStartSdevCwnd", CUBIC_MIB_SDEVCWND),
+	SNMP_MIB_ITEM("HyStartRateDetect", CUBIC_MIB_RATEDETECT),
+	SNMP_MIB_ITEM("HyStartRateCwnd", CUBIC_MIB_RATECWND),
+	SNMP_MIB_ITEM("HyStartPremature", CUBIC_MIB_PREMATURE),
+	SNMP_MIB_ITEM("HyStartExitLoss", CUBIC_MIB_EXITLOSS),
+	SNMP_MIB_ITEM("HyStartSdevSaturated", CUBIC_MIB_SDEVSATURATED),
+	SNMP_MIB_ITEM("HyStartCssEnter", CUBIC_MIB_CSSENTER),
+	SNMP_MIB_ITEM("HyStartCssResume", CUBIC_MIB_CSSRESUME),
+	SNMP_MIB_ITEM("HyStartSharedExit", CUBIC_MIB_SHAREDEXIT),
+	SNMP_MIB_SENTINEL
+};
+
+/* Same two-line layout as /proc/net/netstat, so nstat-style parsers work */
+static int cubic_mib_seq_show(struct seq_file *seq, void *v)
+{
+	unsigned long buff[__CUBIC_MIB_MAX];
+	int i, cpu;
+
+	memset(buff, 0, sizeof(buff));
+	for_each_possible_cpu(cpu)
+		for (i = 0; i < __CUBIC_MIB_MAX; i++)
+			buff[i] += per_cpu(cubic_mib, cpu).mibs[i];
+
+	seq_puts(seq, "CubicExt:");
+	for (i = 0; cubic_mib_list[i].name; i++)
+		seq_printf(seq, " %s", cubic_mib_list[i].name);
+
+	seq_puts(seq, "\nCubicExt:");
+	for (i = 0; cubic_mib_list[i].name; i++)
+		seq_printf(seq, " %lu", buff[cubic_mib_list[i].entry]);
+	seq_putc(seq, '\n');
+	return 0;
+}
+
+static int cubic_mib_seq_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, cubic_mib_seq_show, NULL);
+}
+
+static const struct file_operations cubic_mib_seq_fops = {
+	.owner	 = THIS_MODULE,
+	.open	 = cubic_mib_seq_open,
+	.read	 = seq_read,
+	.llseek	 = seq_lseek,
+	.release = single_release,
+};
+
+static int __init cubic_proc_init(void)
+{
+	if (!proc_create("tcp_cubic", 0444, init_net.proc_net,
+			 &cubic_mib_seq_fops))
+		return -ENOMEM;
+	return 0;
+}
+
+static void cubic_proc_exit(void)
+{
+	remove_proc_entry("tcp_cubic", init_net.proc_net);
+}
+#else
+static inline int cubic_proc_init(void) { return 0; }
+static inline void cubic_proc_exit(void) { }
+#endif
+
+/* "cubic" follows hystart_detect, or the detect mask of the socket's
+ * TCP_CUBIC_HYSTART policy, and hystart_sdev_mode at run time.
+ * "cubic_classic" and "cubic_sdev" pin the exit policy at build time so
+ * their per-ACK paths carry no detection branches, and can be chosen
+ * per socket or per listener with TCP_CONGESTION.
+ */
+#define CUBIC_CLASSIC_DETECT	(HYSTART_ACK_TRAIN | HYSTART_DELAY)
+#define CUBIC_SDEV_DETECT	(HYSTART_ACK_TRAIN | HYSTART_DELAY_SDEV)
+
+static void bictcp_cong_avoid(struct sock *sk, u32 ack, u32 acked)
+{
+	__bictcp_cong_avoid(sk, ack, acked, bictcp_detect(sk));
+}
+
+static void bictcp_acked(struct sock *sk, const struct ack_sample *sample)
+{
+	__bictcp_acked(sk, sample, bictcp_detect(sk), hystart_sdev_mode);
+}
+
+/* The classic policy only looks at delay_min / 8: no RTT statistics */
+static void cubic_classic_init(struct sock *sk)
+{
+	struct bictcp *ca = inet_csk_ca(sk);
+
+	bictcp_init(sk);
+	tcp_sk(sk)->rtt_samples = 0;
+	ca->sdev_off = 1;
+	bictcp_sdev_freeze(sk, true);
+}
+
+static void cubic_classic_cong_avoid(struct sock *sk, u32 ack, u32 acked)
+{
+	__bictcp_cong_avoid(sk, ack, acked, CUBIC_CLASSIC_DETECT);
+}
+
+static void cubic_classic_acked(struct sock *sk,
+				const struct ack_sample *sample)
+{
+	__bictcp_acked(sk, sample, CUBIC_CLASSIC_DETECT, HYSTART_SDEV_OFF);
+}
+
+static void cubic_sdev_init(struct sock *sk)
+{
+	bictcp_init(sk);
+	bictcp_sdev_init(sk, CUBIC_SDEV_DETECT);
+}
+
+static void cubic_sdev_cong_avoid(struct sock *sk, u32 ack, u32 acked)
+{
+	__bictcp_cong_avoid(sk, ack, acked, CUBIC_SDEV_DETECT);
+}
+
+static void cubic_sdev_acked(struct sock *sk, const struct ack_sample *sample)
+{
+	__bictcp_acked(sk, sample, CUBIC_SDEV_DETECT, hystart_sdev_mode);
 }
 
 static struct tcp_congestion_ops cubictcp __read_mostly = {
 	.init		= bictcp_init,
+	.release	= bictcp_release,
 	.ssthresh	= bictcp_recalc_ssthresh,
 	.cong_avoid	= bictcp_cong_avoid,
 	.set_state	= bictcp_state,
 	.undo_cwnd	= tcp_reno_undo_cwnd,
 	.cwnd_event	= bictcp_cwnd_event,
 	.pkts_acked     = bictcp_acked,
+	.get_info	= bictcp_get_info,
 	.owner		= THIS_MODULE,
 	.name		= "cubic",
 };
 
+static struct tcp_congestion_ops cubic_classic __read_mostly = {
+	.init		= cubic_classic_init,
+	.release	= bictcp_release,
+	.ssthresh	= bictcp_recalc_ssthresh,
+	.cong_avoid	= cubic_classic_cong_avoid,
+	.set_state	= bictcp_state,
+	.undo_cwnd	= tcp_reno_undo_cwnd,
+	.cwnd_event	= bictcp_cwnd_event,
+	.pkts_acked	= cubic_classic_acked,
+	.get_info	= bictcp_get_info,
+	.owner		= THIS_MODULE,
+	.name		= "cubic_classic",
+};
+
+static struct tcp_congestion_ops cubic_sdev __read_mostly = {
+	.init		= cubic_sdev_init,
+	.release	= bictcp_release,
+	.ssthresh	= bictcp_recalc_ssthresh,
+	.cong_avoid	= cubic_sdev_cong_avoid,
+	.set_state	= bictcp_state,
+	.undo_cwnd	= tcp_reno_undo_cwnd,
+	.cwnd_event	= bictcp_cwnd_event,
+	.pkts_acked	= cubic_sdev_acked,
+	.get_info	= bictcp_get_info,
+	.owner		= THIS_MODULE,
+	.name		= "cubic_sdev",
+};
+
 static int __init cubictcp_register(void)
 {
+	int ret;
+
 	BUILD_BUG_ON(sizeof(struct bictcp) > ICSK_CA_PRIV_SIZE);
+	BUILD_BUG_ON(TCP_CUBIC_HYSTART_DETECT !=
+		     (HYSTART_ACK_TRAIN | HYSTART_DELAY | HYSTART_DELAY_SDEV |
+		      HYSTART_RATE | HYSTART_CUSTOM));
+	BUILD_BUG_ON(TCP_CUBIC_HYSTART_SHARED != HYSTART_SHARED);
+	BUILD_BUG_ON(sizeof(struct tcp_cubic_info) > sizeof(union tcp_cc_info));
+	BUILD_BUG_ON(WELFORD_VALUE_MAX >= 1U << 24);
 
 	/* Precompute a bunch of the scaling factors that are used per-packet
 	 * based on SRTT of 100ms
@@ -670,12 +2046,38 @@ static int __init cubictcp_register(void)
 	/* divide by bic_scale and by constant Srtt (100ms) */
 	do_div(cube_factor, bic_scale * 10);
 
-	return tcp_register_congestion_control(&cubictcp);
+	ret = cubic_proc_init();
+	if (ret)
+		return ret;
+
+	ret = tcp_register_congestion_control(&cubictcp);
+	if (ret)
+		goto err_proc;
+	ret = tcp_register_congestion_control(&cubic_classic);
+	if (ret)
+		goto err_cubic;
+	ret = tcp_register_congestion_control(&cubic_sdev);
+	if (ret)
+		goto err_classic;
+	return 0;
+
+err_classic:
+	tcp_unregister_congestion_control(&cubic_classic);
+err_cubic:
+	tcp_unregister_congestion_control(&cubictcp);
+err_proc:
+	cubic_proc_exit();
+	return ret;
 }
 
 static void __exit cubictcp_unregister(void)
 {
+	tcp_unregister_congestion_control(&cubic_sdev);
+	tcp_unregister_congestion_control(&cubic_classic);
 	tcp_unregister_congestion_control(&cubictcp);
+	cubic_proc_exit();
+	synchronize_rcu();
+	cubic_dst_flush();
 }
 
 module_init(cubictcp_register);
@@ -683,5 +2085,7 @@ module_exit(cubictcp_unregister);
 
 MODULE_AUTHOR("Sangtae Ha, Stephen Hemminger");
 MODULE_LICENSE("GPL");
+MODULE_ALIAS("tcp_cubic_classic");
+MODULE_ALIAS("tcp_cubic_sdev");
 MODULE_DESCRIPTION("CUBIC TCP");
 MODULE_VERSION("2.3");
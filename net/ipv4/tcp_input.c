@@ -702,13 +702,11 @@ static void tcp_event_data_recv(struct sock *sk, struct sk_buff *skb)
  * To save cycles in the RFC 1323 implementation it was better to break
  * it up into three procedures. -- erics
  */
-static void tcp_rtt_estimator(struct sock *sk, long mrtt_us, u32 pkts_acked)
+static void tcp_rtt_estimator(struct sock *sk, long mrtt_us)
 {
 	struct tcp_sock *tp = tcp_sk(sk);
 	long m = mrtt_us; /* RTT */
 	u32 srtt = tp->srtt_us;
-	int delta, delta2;
-	static long long last_m2 = 0;
 
 	/*	The following amusing code comes from Jacobson's
 	 *	article in SIGCOMM '88.  Note that rtt and mdev
@@ -727,23 +725,6 @@ static void tcp_rtt_estimator(struct sock *sk, long mrtt_us, u32 pkts_acked)
 	 * that VJ failed to avoid. 8)
 	 */
 	
-	/* ***CHANGE***
-	 * In theory this should implament Welford's algorithm to keep a running 
-	 * mean standard deviation of RTT values 
-	 */
-	printk(KERN_INFO "CUBIC DEBUG: measured RTT = %ld\n", (mrtt_us / USEC_PER_MSEC));
-	tp->sdev_stats.num_packets += 1 * pkts_acked;
-	printk(KERN_INFO "CUBIC DEBUG: current mean = %ld\n", tp-> sdev_stats.mean_rtt_us);
-	delta = (mrtt_us) - tp->sdev_stats.mean_rtt_us;
-	printk(KERN_INFO "CUBIC DEBUG: delta = %d\n", delta);
-	tp->sdev_stats.mean_rtt_us += delta / tp->sdev_stats.num_packets;
-	delta2 = (mrtt_us) - tp->sdev_stats.mean_rtt_us;
-	tp->sdev_stats.m2_rtt_ms += ((delta /USEC_PER_MSEC) * (delta2 / USEC_PER_MSEC));
-	if (last_m2 > tp->sdev_stats.m2_rtt_ms){
-		printk(KERN_INFO "CUBIC WARNING: m2 has experinced overflow");
-	}
-	last_m2 = tp->sdev_stats.m2_rtt_ms;
-	
 	if (srtt != 0) {
 		m -= (srtt >> 3);	/* m is now error in rtt est */
 		srtt += m;		/* rtt = 7/8 rtt + 1/8 new */
@@ -812,6 +793,12 @@ static void tcp_update_pacing_rate(struct sock *sk)
 	if (likely(tp->srtt_us))
 		do_div(rate, tp->srtt_us);
 
+	/* The congestion control may hold the rate down for a while,
+	 * e.g. to drain the queue slow start built.
+	 */
+	if (unlikely(tp->pacing_cap))
+		rate = min_t(u64, rate, tp->pacing_cap);
+
 	/* WRITE_ONCE() is needed because sch_fq fetches sk_pacing_rate
 	 * without any lock. We want to make sure compiler wont store
 	 * intermediate values in this location.
@@ -1114,6 +1101,8 @@ static bool tcp_check_dsack(struct sock *sk, const struct sk_buff *ack_skb,
 	return dup_sack;
 }
 
+#define TCP_RTT_SAMPLES_MAX	16
+
 struct tcp_sacktag_state {
 	u32	reord;
 	/* Timestamps for earliest and latest never-retransmitted segment
@@ -1125,8 +1114,45 @@ struct tcp_sacktag_state {
 	struct rate_sample *rate;
 	int	flag;
 	unsigned int mss_now;
+	/* RTTs of every never-retransmitted skb (S)ACKed by this ACK, for
+	 * tp->sdev_stats when tp->rtt_samples is set
+	 */
+	u8	rtt_cnt;
+	struct {
+		u32	rtt_us;
+		u32	pcount;
+	} rtt[TCP_RTT_SAMPLES_MAX];
 };
 
+static inline bool tcp_want_rtt_samples(const struct tcp_sock *tp)
+{
+	return tp->rtt_samples && !tp->sdev_frozen;
+}
+
+static void tcp_rtt_sample_add(const struct tcp_sock *tp,
+			       struct tcp_sacktag_state *state,
+			       u64 xmit_time, u32 pcount)
+{
+	if (state->rtt_cnt < TCP_RTT_SAMPLES_MAX) {
+		state->rtt[state->rtt_cnt].rtt_us =
+			tcp_stamp_us_delta(tp->tcp_mstamp, xmit_time);
+		state->rtt[state->rtt_cnt].pcount = pcount;
+		state->rtt_cnt++;
+	}
+}
+
+/* Merge the RTTs collected from one ACK into tp->sdev_stats in one go */
+static void tcp_rtt_samples_merge(struct tcp_sock *tp,
+				  const struct tcp_sacktag_state *state)
+{
+	int i;
+
+	for (i = 0; i < state->rtt_cnt; i++)
+		welford_update_ewma_n(&tp->sdev_stats, state->rtt[i].rtt_us,
+				      state->rtt[i].pcount,
+				      tp->sdev_ewma_shift);
+}
+
 /* Check if skb is fully within the SACK block. In presence of GSO skbs,
  * the incoming SACK may not exactly match but we can find smaller MSS
  * aligned portion of it that matches. Therefore we might need to fragment
@@ -1234,6 +1260,9 @@ static u8 tcp_sacktag_one(struct sock *sk,
 				if (state->first_sackt == 0)
 					state->first_sackt = xmit_time;
 				state->last_sackt = xmit_time;
+				if (tcp_want_rtt_samples(tp))
+					tcp_rtt_sample_add(tp, state,
+							   xmit_time, pcount);
 			}
 
 			if (sacked & TCPCB_LOST) {
@@ -1669,6 +1698,7 @@ tcp_sacktag_write_queue(struct sock *sk, const struct sk_buff *ack_skb,
 
 	state->flag = 0;
 	state->reord = tp->snd_nxt;
+	state->rtt_cnt = 0;
 
 	if (!tp->sacked_out)
 		tcp_highest_sack_reset(sk);
@@ -2899,8 +2929,7 @@ static void tcp_update_rtt_min(struct sock *sk, u32 rtt_us)
 
 static bool tcp_ack_update_rtt(struct sock *sk, const int flag,
 			       long seq_rtt_us, long sack_rtt_us,
-			       long ca_rtt_us, struct rate_sample *rs,
-			       u32 pkts_acked)
+			       long ca_rtt_us, struct rate_sample *rs)
 {
 	const struct tcp_sock *tp = tcp_sk(sk);
 
@@ -2934,7 +2963,7 @@ static bool tcp_ack_update_rtt(struct sock *sk, const int flag,
 	 * values will be skipped with the seq_rtt_us < 0 check above.
 	 */
 	tcp_update_rtt_min(sk, ca_rtt_us);
-	tcp_rtt_estimator(sk, seq_rtt_us, pkts_acked);
+	tcp_rtt_estimator(sk, seq_rtt_us);
 	tcp_set_rto(sk);
 
 	/* RFC6298: only reset backoff on valid RTT measurement. */
@@ -2950,8 +2979,7 @@ void tcp_synack_rtt_meas(struct sock *sk, struct request_sock *req)
 
 	if (req && !req->num_retrans && tcp_rsk(req)->snt_synack)
 		rtt_us = tcp_stamp_us_delta(tcp_clock_us(), tcp_rsk(req)->snt_synack);
-	// **CHANGE** add a 1 to the end of this for the num packets acked
-	tcp_ack_update_rtt(sk, FLAG_SYN_ACKED, rtt_us, -1L, rtt_us, &rs, 1);
+	tcp_ack_update_rtt(sk, FLAG_SYN_ACKED, rtt_us, -1L, rtt_us, &rs);
 }
 
 
@@ -3061,6 +3089,7 @@ static int tcp_clean_rtx_queue(struct sock *sk, u32 prior_fack,
 	long ca_rtt_us = -1L;
 	u32 pkts_acked = 0;
 	u32 last_in_flight = 0;
+	u8 sack_rtt_cnt = sack->rtt_cnt;
 	bool rtt_update;
 	int flag = 0;
 
@@ -3099,6 +3128,9 @@ static int tcp_clean_rtx_queue(struct sock *sk, u32 prior_fack,
 				first_ackt = last_ackt;
 
 			last_in_flight = TCP_SKB_CB(skb)->tx.in_flight;
+			if (tcp_want_rtt_samples(tp))
+				tcp_rtt_sample_add(tp, sack, last_ackt,
+						   acked_pcount);
 			if (before(start_seq, reord))
 				reord = start_seq;
 			if (!after(scb->end_seq, tp->high_seq))
@@ -3164,7 +3196,7 @@ static int tcp_clean_rtx_queue(struct sock *sk, u32 prior_fack,
 		ca_rtt_us = tcp_stamp_us_delta(tp->tcp_mstamp, sack->last_sackt);
 	}
 	rtt_update = tcp_ack_update_rtt(sk, flag, seq_rtt_us, sack_rtt_us,
-					ca_rtt_us, sack->rate, pkts_acked);
+					ca_rtt_us, sack->rate);
 
 	if (flag & FLAG_ACKED) {
 		flag |= FLAG_SET_XMIT_TIMER;  /* set TLP or RTO timer */
@@ -3203,6 +3235,15 @@ static int tcp_clean_rtx_queue(struct sock *sk, u32 prior_fack,
 		flag |= FLAG_SET_XMIT_TIMER;  /* set TLP or RTO timer */
 	}
 
+	/* Like seq_rtt_us, the cumulatively ACKed skbs give no samples when
+	 * retransmitted data was ACKed too; the SACKed ones always do.
+	 */
+	if (tcp_want_rtt_samples(tp)) {
+		if (flag & FLAG_RETRANS_DATA_ACKED)
+			sack->rtt_cnt = sack_rtt_cnt;
+		tcp_rtt_samples_merge(tp, sack);
+	}
+
 	if (icsk->icsk_ca_ops->pkts_acked) {
 		struct ack_sample sample = { .pkts_acked = pkts_acked,
 					     .rtt_us = sack->rate->rtt_us,
@@ -3551,6 +3592,7 @@ static int tcp_ack(struct sock *sk, const struct sk_buff *skb, int flag)
 	u32 prior_fack;
 
 	sack_state.first_sackt = 0;
+	sack_state.rtt_cnt = 0;
 	sack_state.rate = &rs;
 
 	/* We very likely will need to access rtx queue. */
@@ -0,0 +1,438 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Per-ACK cost of CUBIC, pkts_acked() and cong_avoid() together, in TSC
+ * cycles where there is one and ns otherwise.
+ *
+ * Each configuration runs over 1, 8 and 64 sockets ACKed round robin,
+ * so the larger sets also pay for the cache footprint of tcp_sock and
+ * the CA private area.  Every ACK is timed on its own; p50 and p99 are
+ * reported together with their delta against the stock 4.15 module in
+ * the same phase, built from stock/tcp_cubic.c.
+ *
+ *	stock		stock 4.15 "cubic" in slow start, the reference
+ *	off		"cubic", default parameters, tracepoints disabled
+ *	trace		"cubic" with the cubic_acked tracepoint enabled
+ *	classic		"cubic_classic"
+ *	sdev		"cubic_sdev", cumulative Welford deviation
+ *	welford		welford_update_ewma_n() alone, the per-skb update
+ *			tcp_clean_rtx_queue() does with hystart_sdev_samples
+ *	stock-ca	stock 4.15 "cubic" in congestion avoidance, the
+ *			reference of ca
+ *	ca		"cubic" in congestion avoidance
+ *
+ * A socket that leaves slow start is reinitialised, and one in
+ * congestion avoidance takes a loss once its cwnd is large, outside the
+ * timed region.
+ *
+ * Usage:
+ *	cubic_bench [-c config,..] [-n calls] [-s seed] [-w file]
+ *		    [-r file [-g percent]]
+ *
+ * -w saves the p50s, -r reads a saved run and reports against it, and
+ * with -g the run fails if any p50 grew by more than percent, which
+ * makes it usable as a regression gate across a change:
+ *
+ *	git stash; make cubic_bench && ./cubic_bench -w base
+ *	git stash pop; make cubic_bench && ./cubic_bench -r base -g 10
+ */
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../../../net/ipv4/tcp_cubic.c"
+
+struct net init_net;
+u64 cubic_now_us;
+bool cubic_trace_enabled;
+
+#define BENCH_WARMUP	10000
+#define BENCH_RTT_US	20000
+#define BENCH_JITTER_US	2000
+#define BENCH_CWND_MAX	4096
+#define BENCH_CA_CWND	512	/* initial cwnd in congestion avoidance */
+
+static const u32 nr_socks[] = { 1, 8, 64 };
+
+enum {
+	BENCH_STOCK,
+	BENCH_OFF,
+	BENCH_TRACE,
+	BENCH_CLASSIC,
+	BENCH_SDEV,
+	BENCH_WELFORD,
+	BENCH_STOCK_CA,
+	BENCH_CA,
+	__BENCH_MAX
+};
+
+static const char * const bench_names[] = {
+	[BENCH_STOCK]	 = "stock",
+	[BENCH_OFF]	 = "off",
+	[BENCH_TRACE]	 = "trace",
+	[BENCH_CLASSIC]	 = "classic",
+	[BENCH_SDEV]	 = "sdev",
+	[BENCH_WELFORD]	 = "welford",
+	[BENCH_STOCK_CA] = "stock-ca",
+	[BENCH_CA]	 = "ca",
+};
+
+static bool bench_avoid(int config)
+{
+	return config == BENCH_STOCK_CA || config == BENCH_CA;
+}
+
+/* The stock module in the same phase */
+static int bench_ref(int config)
+{
+	return bench_avoid(config) ? BENCH_STOCK_CA : BENCH_STOCK;
+}
+
+/* cubic_stock.c */
+struct tcp_congestion_ops *cubic_stock_ops(void);
+
+#if defined(__x86_64__) || defined(__i386__)
+#define BENCH_UNIT	"cycles"
+static inline u64 bench_clock(void)
+{
+	u32 lo, hi;
+
+	asm volatile("lfence; rdtsc; lfence" : "=a" (lo), "=d" (hi)
+		     :: "memory");
+	return (u64)hi << 32 | lo;
+}
+#else
+#define BENCH_UNIT	"ns"
+static inline u64 bench_clock(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+#endif
+
+static u64 rng_state = 1;
+
+static u32 rng_below(u32 n)
+{
+	/* xorshift64* */
+	rng_state ^= rng_state >> 12;
+	rng_state ^= rng_state << 25;
+	rng_state ^= rng_state >> 27;
+	return ((rng_state * 0x2545F4914F6CDD1DULL) >> 32) * n >> 32;
+}
+
+static u64 clock_overhead;
+
+static void clock_calibrate(void)
+{
+	u64 best = U64_MAX;
+	int i;
+
+	for (i = 0; i < 100000; i++) {
+		u64 t0 = bench_clock();
+		u64 t1 = bench_clock();
+
+		best = min(best, t1 - t0);
+	}
+	clock_overhead = best;
+}
+
+static int cmp_u64(const void *a, const void *b)
+{
+	u64 x = *(const u64 *)a, y = *(const u64 *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+static void sock_init(struct tcp_sock *tp, struct tcp_congestion_ops *ops,
+		      u32 i, bool avoid)
+{
+	struct sock *sk = &tp->sk;
+
+	memset(tp, 0, sizeof(*tp));
+	sk->net = &init_net;
+	sk->sk_family = AF_INET;
+	inet_sk(sk)->inet_daddr = htonl(0x0a000000 + i);
+	tp->snd_cwnd = avoid ? BENCH_CA_CWND : hystart_low_window;
+	tp->snd_ssthresh = avoid ? BENCH_CA_CWND : TCP_INFINITE_SSTHRESH;
+	tp->snd_cwnd_clamp = ~0U;
+	tp->snd_nxt = tp->snd_cwnd;
+	inet_csk(sk)->icsk_ca_ops = ops;
+	ops->init(sk);
+}
+
+static struct tcp_congestion_ops *bench_setup(int config)
+{
+	cubic_trace_enabled = false;
+	telemetry = 0;
+	hystart_detect = HYSTART_ACK_TRAIN | HYSTART_DELAY;
+	hystart_sdev_mode = HYSTART_SDEV_OFF;
+
+	switch (config) {
+	case BENCH_STOCK:
+	case BENCH_STOCK_CA:
+		return cubic_stock_ops();
+	case BENCH_TRACE:
+		cubic_trace_enabled = true;
+		telemetry = 1;
+		return &cubictcp;
+	case BENCH_CLASSIC:
+		return &cubic_classic;
+	case BENCH_SDEV:
+		hystart_sdev_mode = HYSTART_SDEV_CUMULATIVE;
+		return &cubic_sdev;
+	default:
+		return &cubictcp;
+	}
+}
+
+static void sock_release(struct tcp_sock *tp, struct tcp_congestion_ops *ops)
+{
+	if (ops->release)
+		ops->release(&tp->sk);
+}
+
+/* Time that many ACKs over nr sockets into samples[] */
+static void bench_run(int config, u32 nr, u64 *samples, u32 calls)
+{
+	struct tcp_congestion_ops *ops = bench_setup(config);
+	bool avoid = bench_avoid(config);
+	struct tcp_sock *socks;
+	struct welford w;
+	u32 i;
+
+	socks = aligned_alloc(64, nr * sizeof(*socks));
+	if (!socks) {
+		perror("aligned_alloc");
+		exit(1);
+	}
+	cubic_now_us = 1000000;
+	for (i = 0; i < nr; i++)
+		sock_init(&socks[i], ops, i, avoid);
+	welford_reset(&w);
+
+	for (i = 0; i < BENCH_WARMUP + calls; i++) {
+		struct tcp_sock *tp = &socks[i % nr];
+		struct sock *sk = &tp->sk;
+		struct ack_sample sample = {
+			.pkts_acked	= 1 + (rng_below(8) == 0),
+			.rtt_us		= BENCH_RTT_US +
+					  rng_below(BENCH_JITTER_US),
+			.in_flight	= tp->snd_cwnd,
+		};
+		u64 t0, t1;
+
+		/* ACKs of each socket arrive every 200 usec */
+		cubic_now_us += 200 / nr + 1;
+		tp->tcp_mstamp = cubic_now_us;
+
+		if (config == BENCH_WELFORD) {
+			t0 = bench_clock();
+			welford_update_ewma_n(&w, sample.rtt_us,
+					      sample.pkts_acked, 3);
+			t1 = bench_clock();
+		} else {
+			tp->snd_una += sample.pkts_acked;
+			t0 = bench_clock();
+			ops->pkts_acked(sk, &sample);
+			ops->cong_avoid(sk, tp->snd_una, sample.pkts_acked);
+			t1 = bench_clock();
+
+			tp->snd_nxt = tp->snd_una + tp->snd_cwnd;
+			if (avoid && tp->snd_cwnd > BENCH_CWND_MAX) {
+				tp->snd_ssthresh = ops->ssthresh(sk);
+				tp->snd_cwnd = tp->snd_ssthresh;
+			} else if (!avoid && (!tcp_in_slow_start(tp) ||
+					      tp->snd_cwnd > BENCH_CWND_MAX)) {
+				sock_release(tp, ops);
+				sock_init(tp, ops, i % nr, avoid);
+			}
+		}
+
+		if (i >= BENCH_WARMUP)
+			samples[i - BENCH_WARMUP] =
+				max(t1 - t0, clock_overhead) - clock_overhead;
+	}
+
+	for (i = 0; i < nr; i++)
+		sock_release(&socks[i], ops);
+	free(socks);
+}
+
+static void bench_percentiles(u64 *samples, u32 calls, u64 *p50, u64 *p99)
+{
+	qsort(samples, calls, sizeof(*samples), cmp_u64);
+	*p50 = samples[calls / 2];
+	*p99 = samples[(u64)calls * 99 / 100];
+}
+
+/* A saved run: one "config sockets p50" line per measurement */
+static void bench_save(const char *path, u32 mask,
+		       u64 p50[][ARRAY_SIZE(nr_socks)])
+{
+	unsigned int j;
+	FILE *f;
+	int i;
+
+	f = fopen(path, "w");
+	if (!f) {
+		perror(path);
+		exit(1);
+	}
+	for (i = 0; i < __BENCH_MAX; i++) {
+		if (!(mask & (1U << i)))
+			continue;
+		for (j = 0; j < ARRAY_SIZE(nr_socks); j++)
+			fprintf(f, "%s %u %llu\n", bench_names[i], nr_socks[j],
+				(unsigned long long)p50[i][j]);
+	}
+	fclose(f);
+}
+
+static void bench_load(const char *path, u64 base[][ARRAY_SIZE(nr_socks)])
+{
+	unsigned long long v;
+	char name[32];
+	unsigned int j;
+	u32 nr;
+	FILE *f;
+	int i;
+
+	f = fopen(path, "r");
+	if (!f) {
+		perror(path);
+		exit(1);
+	}
+	while (fscanf(f, "%31s %u %llu", name, &nr, &v) == 3) {
+		for (i = 0; i < __BENCH_MAX; i++)
+			if (!strcmp(bench_names[i], name))
+				break;
+		for (j = 0; j < ARRAY_SIZE(nr_socks); j++)
+			if (i < __BENCH_MAX && nr_socks[j] == nr)
+				base[i][j] = v;
+	}
+	fclose(f);
+}
+
+static void usage(void)
+{
+	int i;
+
+	fprintf(stderr, "usage: cubic_bench [-c config,..] [-n calls]"
+		" [-s seed] [-w file]\n"
+		"                   [-r file [-g percent]]\n\nconfigs:");
+	for (i = 0; i < __BENCH_MAX; i++)
+		fprintf(stderr, " %s", bench_names[i]);
+	fprintf(stderr, "\n");
+	exit(2);
+}
+
+int main(int argc, char **argv)
+{
+	u64 p50[__BENCH_MAX][ARRAY_SIZE(nr_socks)];
+	u64 p99[__BENCH_MAX][ARRAY_SIZE(nr_socks)];
+	u64 base[__BENCH_MAX][ARRAY_SIZE(nr_socks)] = { { 0 } };
+	const char *save = NULL, *ref = NULL;
+	u32 mask = ~0U, calls = 1000000;
+	int gate = -1, failed = 0;
+	unsigned int j;
+	char *name;
+	u64 *samples;
+	int opt, i;
+
+	while ((opt = getopt(argc, argv, "c:n:s:w:r:g:h")) != -1) {
+		switch (opt) {
+		case 'c':
+			mask = 0;
+			for (name = strtok(optarg, ","); name;
+			     name = strtok(NULL, ",")) {
+				for (i = 0; i < __BENCH_MAX; i++)
+					if (!strcmp(bench_names[i], name))
+						break;
+				if (i == __BENCH_MAX)
+					usage();
+				mask |= 1U << i;
+			}
+			break;
+		case 'n':
+			calls = max(strtoul(optarg, NULL, 0), 100UL);
+			break;
+		case 's':
+			rng_state = strtoull(optarg, NULL, 0) ?: 1;
+			break;
+		case 'w':
+			save = optarg;
+			break;
+		case 'r':
+			ref = optarg;
+			break;
+		case 'g':
+			gate = atoi(optarg);
+			break;
+		default:
+			usage();
+		}
+	}
+	if (optind != argc || (gate >= 0 && !ref))
+		usage();
+
+	/* The references always run */
+	for (i = 0; i < __BENCH_MAX; i++)
+		if (mask & (1U << i))
+			mask |= 1U << bench_ref(i);
+
+	samples = malloc(calls * sizeof(*samples));
+	if (!samples) {
+		perror("malloc");
+		return 1;
+	}
+	cubictcp_register();
+	clock_calibrate();
+
+	for (i = 0; i < __BENCH_MAX; i++) {
+		if (!(mask & (1U << i)))
+			continue;
+		for (j = 0; j < ARRAY_SIZE(nr_socks); j++) {
+			bench_run(i, nr_socks[j], samples, calls);
+			bench_percentiles(samples, calls, &p50[i][j],
+					  &p99[i][j]);
+		}
+	}
+
+	if (save)
+		bench_save(save, mask, p50);
+	if (ref)
+		bench_load(ref, base);
+
+	printf("%-8s %7s %8s %8s %8s %8s %8s   (%s, %u calls)\n", "config",
+	       "sockets", "p50", "p99", "d_p50", "d_p99",
+	       ref ? "base_p50" : "", BENCH_UNIT, calls);
+	for (i = 0; i < __BENCH_MAX; i++) {
+		if (!(mask & (1U << i)))
+			continue;
+		for (j = 0; j < ARRAY_SIZE(nr_socks); j++) {
+			s64 d50 = p50[i][j] - p50[bench_ref(i)][j];
+			s64 d99 = p99[i][j] - p99[bench_ref(i)][j];
+			bool over = gate >= 0 && base[i][j] &&
+				    p50[i][j] * 100 >
+				    base[i][j] * (100 + gate);
+
+			printf("%-8s %7u %8llu %8llu %+8lld %+8lld",
+			       bench_names[i], nr_socks[j],
+			       (unsigned long long)p50[i][j],
+			       (unsigned long long)p99[i][j],
+			       (long long)d50, (long long)d99);
+			if (ref)
+				printf(" %8llu%s",
+				       (unsigned long long)base[i][j],
+				       over ? "   FAIL" : "");
+			printf("\n");
+			failed |= over;
+		}
+	}
+
+	free(samples);
+	return failed;
+}
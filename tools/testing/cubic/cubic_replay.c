@@ -0,0 +1,1077 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Userspace replay harness for TCP CUBIC's HyStart.
+ *
+ * net/ipv4/tcp_cubic.c is built as is against the shim headers in this
+ * directory and driven through its tcp_congestion_ops, either by a
+ * closed-loop single-bottleneck model (cwnd limited, FIFO, drop tail,
+ * paced only while the CA sets tp->pacing_cap) or open loop from a
+ * captured trace.  For every exit policy the harness reports where slow
+ * start ended and what one ACK cost:
+ *
+ *	exit_cwnd	cwnd when HyStart (or the first loss) ended slow start
+ *	exit_round	round trips since the start of the flow
+ *	overshoot	exit_cwnd in percent of the path BDP
+ *	loss		flows that lost a packet in slow start or in the
+ *			two rounds after the exit
+ *	trig		flows per exit cause: T(rain) D(elay) S(dev) R(ate)
+ *			C(ustom predicate), H (a flow sharing the
+ *			bottleneck), L(oss, or the
+ *			ssthresh the destination cache seeded) or N(one
+ *			within the round limit)
+ *	ns/ack		pkts_acked() + cong_avoid() per ACK
+ *
+ * Usage:
+ *	cubic_replay [-m mode,..] [-p profile,..] [-n flows] [-s seed]
+ *		     [-a acks] [-r rounds] [-g gap_ms] [-o param=value]...
+ *		     [-d dump] [-P detect,low_window,ack_delta_ms,delay_max_ms]
+ *		     [-c trig[,lo,hi]]
+ *	cubic_replay -f trace [-b bdp] [-m mode,..] [-o param=value]...
+ *		     [-c trig[,lo,hi]]
+ *
+ * Modes are classic, sdev, sdev-round, ewma, percentile, rate, custom
+ * (an example cubic_hystart_ops: leave once the round's minimum RTT is
+ * two standard deviations above the mean) and the registered variants
+ * cubic_classic and cubic_sdev; the default is all of them.  Profiles
+ * are geo, geobuf (geo behind a 4 BDP satellite modem buffer), lte, wan
+ * and dc.  -o sets any module parameter after the mode has set its own,
+ * -P gives every flow that TCP_CUBIC_HYSTART policy instead, -a acks
+ * every n-th packet and -d writes the ACKs of the first synthetic flow
+ * in trace format.  -g starts the flows gap_ms apart on one bottleneck
+ * rather than one after another, so that they overlap.  -c makes
+ * cubic_replay exit with 1 unless, in every run, at least half the
+ * flows exit by trig (one of the letters of the trig column) and, with
+ * lo,hi, the mean overshoot is within lo..hi percent.
+ *
+ * A trace has one ACK per line, "t_us rtt_us [pkts_acked]", with '#'
+ * comments; e.g. from a capture:
+ *
+ *	tshark -r x.pcap -Y tcp.analysis.ack_rtt -T fields \
+ *		-e frame.time_relative -e tcp.analysis.ack_rtt |
+ *	awk '{ printf "%d %d\n", $1 * 1e6, $2 * 1e6 }'
+ */
+#define _GNU_SOURCE
+#include <getopt.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "../../../net/ipv4/tcp_cubic.c"
+
+struct net init_net;
+u64 cubic_now_us;
+bool cubic_trace_enabled;
+
+/* Flows run one after another on one clock, far enough apart that only
+ * the per-destination cache, not the live shared state, links them;
+ * with -g they instead start gap_ms apart and share one bottleneck.
+ */
+#define FLOW_GAP_US	(100 * USEC_PER_SEC)
+static u64 run_start_us;
+
+#define MSS_WIRE_BITS	(1500 * 8)
+#define DEFAULT_ROUNDS	200
+#define TAIL_ROUNDS	2	/* rounds followed after the exit */
+
+struct profile {
+	const char	*name;
+	u32		rate_mbps;
+	u32		base_rtt_us;
+	u32		buffer_pct;	/* of the BDP */
+	u32		buffer_min;	/* packets */
+	u32		jitter_us;	/* uniform on the ACK path */
+	u32		spike_permille;	/* ACKs delayed by spike_us */
+	u32		spike_us;
+};
+
+static const struct profile profiles[] = {
+	{ "geo",   50,  600000, 100,  64, 2000, 0,  0 },
+	{ "geobuf", 50, 600000, 400,  64, 2000, 0,  0 },
+	{ "lte",   20,   60000, 200,  64, 8000, 10, 30000 },
+	{ "wan",  100,   40000, 100,  64,  500, 0,  0 },
+	{ "dc", 10000,      50,   0, 400,   20, 1,  200 },
+};
+
+struct mode {
+	const char			*name;
+	struct tcp_congestion_ops	*ops;
+	int				detect;
+	int				sdev_mode;
+	int				percentile;
+};
+
+static const struct mode modes[] = {
+	{ "classic",	   &cubictcp, HYSTART_ACK_TRAIN | HYSTART_DELAY,
+	  HYSTART_SDEV_OFF, 0 },
+	{ "sdev",	   &cubictcp, HYSTART_ACK_TRAIN | HYSTART_DELAY_SDEV,
+	  HYSTART_SDEV_CUMULATIVE, 0 },
+	{ "sdev-round",	   &cubictcp, HYSTART_ACK_TRAIN | HYSTART_DELAY_SDEV,
+	  HYSTART_SDEV_ROUND, 0 },
+	{ "ewma",	   &cubictcp, HYSTART_ACK_TRAIN | HYSTART_DELAY,
+	  HYSTART_SDEV_EWMA, 0 },
+	{ "percentile",	   &cubictcp, HYSTART_ACK_TRAIN | HYSTART_DELAY,
+	  HYSTART_SDEV_OFF, 50 },
+	{ "rate",	   &cubictcp, HYSTART_ACK_TRAIN | HYSTART_RATE,
+	  HYSTART_SDEV_OFF, 0 },
+	{ "custom",	   &cubictcp, HYSTART_ACK_TRAIN | HYSTART_CUSTOM,
+	  HYSTART_SDEV_CUMULATIVE, 0 },
+	{ "cubic_classic", &cubic_classic, 0, HYSTART_SDEV_OFF, 0 },
+	{ "cubic_sdev",	   &cubic_sdev, 0, HYSTART_SDEV_CUMULATIVE, 0 },
+};
+
+#define PARAM(p)	{ #p, &p }
+
+static struct param {
+	const char	*name;
+	int		*val;
+	int		def;
+} params[] = {
+	PARAM(fast_convergence),
+	PARAM(beta),
+	PARAM(initial_ssthresh),
+	PARAM(bic_scale),
+	PARAM(tcp_friendliness),
+	PARAM(hystart),
+	PARAM(hystart_detect),
+	PARAM(hystart_low_window),
+	PARAM(hystart_ack_delta),
+	PARAM(hystart_delay_max),
+	PARAM(hystart_delay_min),
+	PARAM(hystart_sdev_mode),
+	PARAM(hystart_sdev_ewma_shift),
+	PARAM(hystart_sdev_k),
+	PARAM(hystart_sdev_min),
+	PARAM(hystart_sdev_max),
+	PARAM(telemetry),
+	PARAM(hystart_dst_cache),
+	PARAM(hystart_dst_share),
+	PARAM(hystart_sdev_samples),
+	PARAM(hystart_rtt_percentile),
+	PARAM(hystart_rate_growth),
+	PARAM(hystart_rate_rounds),
+	PARAM(hystart_exit_loss_rtts),
+	PARAM(hystart_pacing_drain),
+	PARAM(hystart_css_rounds),
+	PARAM(hystart_css_growth_divisor),
+};
+
+struct override {
+	struct param	*param;
+	int		val;
+};
+
+static struct override overrides[ARRAY_SIZE(params)];
+static int nr_overrides;
+
+/* Result of one flow */
+struct result {
+	u32	exit_cwnd;
+	u32	exit_round;
+	u64	exit_us;
+	u8	found;
+	bool	exited;
+	bool	loss;		/* ended slow start by a loss */
+	bool	tail_loss;	/* lost in slow start or just after */
+	u64	acks;
+	u64	cc_ns;
+};
+
+struct summary {
+	u32	flows;
+	double	exit_cwnd;
+	double	exit_round;
+	double	exit_ms;
+	double	overshoot;
+	u32	losses;
+	u32	trig[8];	/* T D S R C H L N */
+	u64	acks;
+	u64	cc_ns;
+};
+
+/* Simulated packet, indexed by sequence number */
+struct pkt {
+	u64	sent_ns;
+	u64	ack_ns;
+	u64	delivered_ns;	/* delivered_ns when it was sent */
+	u32	delivered;	/* delivered count when it was sent */
+	bool	lost;
+};
+
+/* The bottleneck, one drop tail FIFO for all the flows of a run */
+struct link {
+	u64	tx_ns;		/* wire time of one packet */
+	u32	bdp;		/* packets */
+	u32	buffer;		/* packets */
+	u64	free_ns;	/* when the link has sent what is queued */
+};
+
+/* One simulated flow.  Times are on the run's clock, which starts at
+ * run_start_us; a flow of the run starts start_ns into it.
+ */
+struct flow {
+	struct tcp_sock	tp;
+	struct result	res;
+	struct pkt	*pkts;
+	u32		ring;
+	u64		rng;
+	u64		start_ns;
+	u64		now_ns;
+	u64		next_tx_ns;	/* next send the pacing cap allows */
+	u64		last_ack_ns;
+	u64		delivered_ns;
+	u32		head;		/* oldest packet not ACKed */
+	u32		tail;		/* next packet to send */
+	u32		delivered;
+	u32		round;
+	u32		round_end;
+	bool		started;
+	bool		paced;		/* the pacing cap holds back a send */
+	bool		loss_pending;
+	bool		done;
+	FILE		*dump;
+};
+
+static u64 rng(u64 *state)
+{
+	/* xorshift64* */
+	*state ^= *state >> 12;
+	*state ^= *state << 25;
+	*state ^= *state >> 27;
+	return *state * 0x2545F4914F6CDD1DULL;
+}
+
+static u32 rng_below(u64 *state, u32 n)
+{
+	return n ? (u32)((rng(state) >> 32) * n >> 32) : 0;
+}
+
+static u64 clock_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* Cost of the clock_ns() pair bracketing each ACK */
+static u64 clock_overhead_ns;
+
+static void clock_calibrate(void)
+{
+	u64 best = U64_MAX;
+	int i;
+
+	for (i = 0; i < 10000; i++) {
+		u64 t0 = clock_ns();
+		u64 t1 = clock_ns();
+
+		best = min(best, t1 - t0);
+	}
+	clock_overhead_ns = best;
+}
+
+static void params_save(void)
+{
+	unsigned int i;
+
+	for (i = 0; i < ARRAY_SIZE(params); i++)
+		params[i].def = *params[i].val;
+}
+
+/* Example predicate for the custom mode: the round's minimum RTT sits
+ * more than two standard deviations above the flow's mean RTT.
+ */
+static int custom_exit(const struct cubic_hystart_ctx *ctx)
+{
+	u64 sdev = cubic_isqrt(ctx->var_us2);
+
+	if (ctx->sample_cnt < HYSTART_MIN_SAMPLES || !ctx->mean_us)
+		return CUBIC_HYSTART_DEFAULT;
+	return ctx->curr_rtt_us > ctx->mean_us + 2 * sdev ?
+	       CUBIC_HYSTART_EXIT : CUBIC_HYSTART_CONTINUE;
+}
+
+static struct cubic_hystart_ops custom_ops = {
+	.exit	= custom_exit,
+	.name	= "replay",
+};
+
+/* Module parameters for mode m: defaults, then the mode, then -o */
+static void params_apply(const struct mode *m)
+{
+	unsigned int i;
+
+	for (i = 0; i < ARRAY_SIZE(params); i++)
+		*params[i].val = params[i].def;
+	if (m->detect)
+		hystart_detect = m->detect;
+	hystart_sdev_mode = m->sdev_mode;
+	hystart_rtt_percentile = m->percentile;
+	for (i = 0; i < nr_overrides; i++)
+		*overrides[i].param->val = overrides[i].val;
+
+	cubic_dst_flush();
+	memset(&cubic_mib, 0, sizeof(cubic_mib));
+	cubictcp_register();
+	cubic_hystart_unregister(&custom_ops);
+	if (hystart_detect & HYSTART_CUSTOM)
+		cubic_hystart_register(&custom_ops);
+}
+
+static int param_override(const char *arg)
+{
+	const char *eq = strchr(arg, '=');
+	unsigned int i;
+
+	if (!eq)
+		return -EINVAL;
+	for (i = 0; i < ARRAY_SIZE(params); i++) {
+		if (strlen(params[i].name) != (size_t)(eq - arg) ||
+		    strncmp(params[i].name, arg, eq - arg))
+			continue;
+		overrides[nr_overrides].param = &params[i];
+		overrides[nr_overrides].val = strtol(eq + 1, NULL, 0);
+		nr_overrides++;
+		return 0;
+	}
+	return -ENOENT;
+}
+
+/* TCP_CUBIC_HYSTART policy of every flow, from -P */
+static struct tcp_cubic_policy flow_policy;
+
+static void flow_init(struct tcp_sock *tp, const struct mode *m, u32 daddr)
+{
+	struct sock *sk = &tp->sk;
+
+	memset(tp, 0, sizeof(*tp));
+	sk->net = &init_net;
+	sk->sk_family = AF_INET;
+	inet_sk(sk)->inet_daddr = daddr;
+	tp->snd_cwnd = 10;
+	tp->snd_ssthresh = TCP_INFINITE_SSTHRESH;
+	tp->snd_cwnd_clamp = ~0U;
+	tp->mss_cache = 1448;
+	tp->tcp_mstamp = cubic_now_us;
+	tp->cubic_hystart = flow_policy;
+	inet_csk(sk)->icsk_ca_ops = m->ops;
+	m->ops->init(sk);
+}
+
+static void flow_release(struct tcp_sock *tp)
+{
+	const struct tcp_congestion_ops *ops = inet_csk(&tp->sk)->icsk_ca_ops;
+
+	if (ops->release)
+		ops->release(&tp->sk);
+}
+
+/* sk_pacing_rate as tcp_update_pacing_rate() leaves it after each ACK */
+static void flow_pacing_rate(struct tcp_sock *tp)
+{
+	u64 rate = (u64)tp->mss_cache * ((USEC_PER_SEC / 100) << 3);
+
+	rate *= tp->snd_cwnd < tp->snd_ssthresh / 2 ? 200 : 120;
+	rate *= max(tp->snd_cwnd, tp->packets_out);
+	if (tp->srtt_us)
+		rate /= tp->srtt_us;
+	if (tp->pacing_cap)
+		rate = min_t(u64, rate, tp->pacing_cap);
+	tp->sk.sk_pacing_rate = min_t(u64, rate, U32_MAX);
+}
+
+/* One ACK: the CA hooks in the order tcp_ack() calls them, timed */
+static void flow_ack(struct tcp_sock *tp, struct result *res, u32 acked,
+		     u32 rtt_us)
+{
+	const struct tcp_congestion_ops *ops = inet_csk(&tp->sk)->icsk_ca_ops;
+	struct ack_sample sample = {
+		.pkts_acked	= acked,
+		.rtt_us		= rtt_us,
+		.in_flight	= tp->packets_out,
+	};
+	u64 t0, t1;
+
+	t0 = clock_ns();
+	ops->pkts_acked(&tp->sk, &sample);
+	ops->cong_avoid(&tp->sk, tp->snd_una, acked);
+	t1 = clock_ns();
+
+	res->cc_ns += max(t1 - t0, clock_overhead_ns) - clock_overhead_ns;
+	res->acks++;
+	flow_pacing_rate(tp);
+}
+
+static void flow_loss(struct tcp_sock *tp)
+{
+	const struct tcp_congestion_ops *ops = inet_csk(&tp->sk)->icsk_ca_ops;
+
+	tp->prior_cwnd = tp->snd_cwnd;
+	tp->snd_ssthresh = ops->ssthresh(&tp->sk);
+	tp->snd_cwnd = tp->snd_ssthresh;
+	if (ops->set_state)
+		ops->set_state(&tp->sk, TCP_CA_Recovery);
+}
+
+static bool flow_check_exit(const struct tcp_sock *tp, struct result *res,
+			    u32 round, bool loss, u64 start_us)
+{
+	const struct bictcp *ca = inet_csk_ca(&tp->sk);
+
+	if (res->exited)
+		return false;
+	if (!loss && !ca->found && tcp_in_slow_start(tp))
+		return false;
+
+	res->exited = true;
+	res->loss = loss && !ca->found;
+	res->found = ca->found;
+	res->exit_cwnd = loss ? tp->prior_cwnd : tp->snd_cwnd;
+	res->exit_round = round;
+	res->exit_us = cubic_now_us - start_us;
+	return true;
+}
+
+static void sim_stop(struct flow *f)
+{
+	flow_release(&f->tp);
+	free(f->pkts);
+	f->pkts = NULL;
+	f->done = true;
+}
+
+static struct pkt *sim_pkt(const struct flow *f, u32 seq)
+{
+	return &f->pkts[seq & (f->ring - 1)];
+}
+
+/* The pacing cap, not an ACK, decides what the flow does next */
+static bool sim_pacing_wake(const struct flow *f)
+{
+	return f->paced && (f->head == f->tail ||
+			    f->next_tx_ns < sim_pkt(f, f->head)->ack_ns);
+}
+
+/* When the flow next has something to do: start, send or take an ACK */
+static u64 sim_next_ns(const struct flow *f)
+{
+	if (!f->started)
+		return f->start_ns;
+	if (sim_pacing_wake(f))
+		return max(f->next_tx_ns, f->now_ns);
+	return sim_pkt(f, f->head)->ack_ns;
+}
+
+/* Send whatever cwnd and the CA's pacing cap allow now */
+static void sim_send(struct flow *f, struct link *l, const struct profile *p)
+{
+	struct tcp_sock *tp = &f->tp;
+
+	while (f->tail - f->head < tp->snd_cwnd &&
+	       f->tail - f->head < f->ring) {
+		u64 start = max(f->now_ns, l->free_ns);
+		struct pkt *pkt;
+
+		if (tp->pacing_cap && f->next_tx_ns > f->now_ns) {
+			f->paced = true;
+			break;
+		}
+
+		pkt = sim_pkt(f, f->tail);
+		pkt->sent_ns = f->now_ns;
+		pkt->delivered = f->delivered;
+		pkt->delivered_ns = f->delivered_ns;
+		pkt->lost = (start - f->now_ns) / l->tx_ns >= l->buffer;
+		if (!pkt->lost) {
+			u64 ack_ns = start + l->tx_ns +
+				     p->base_rtt_us * 1000ULL +
+				     rng_below(&f->rng, p->jitter_us) * 1000ULL;
+
+			if (rng_below(&f->rng, 1000) < p->spike_permille)
+				ack_ns += p->spike_us * 1000ULL;
+			l->free_ns = start + l->tx_ns;
+			f->last_ack_ns = max(f->last_ack_ns, ack_ns);
+		}
+		/* ACKs stay in order; a loss shows with the next one */
+		f->last_ack_ns = max(f->last_ack_ns, f->now_ns);
+		pkt->ack_ns = f->last_ack_ns;
+		f->tail++;
+		if (tp->pacing_cap)
+			f->next_tx_ns = max(f->next_tx_ns, f->now_ns) +
+					tp->mss_cache * 1000000000ULL /
+					tp->pacing_cap;
+	}
+	tp->snd_nxt = f->tail;
+}
+
+static void sim_start(struct flow *f, const struct link *l,
+		      const struct mode *m)
+{
+	f->ring = 1U << fls(4 * (l->bdp + l->buffer) + 64);
+	f->pkts = calloc(f->ring, sizeof(*f->pkts));
+	if (!f->pkts) {
+		perror("calloc");
+		exit(1);
+	}
+	f->started = true;
+	f->now_ns = f->start_ns;
+	cubic_now_us = run_start_us + f->now_ns / 1000;
+	flow_init(&f->tp, m, htonl(0x0a000001));
+}
+
+/* Take the next ACK; false once the flow is over */
+static bool sim_ack(struct flow *f, u32 ack_every, u32 max_rounds)
+{
+	struct tcp_sock *tp = &f->tp;
+	struct result *res = &f->res;
+	struct pkt *pkt;
+	u32 acked = 0;
+
+	do {
+		pkt = sim_pkt(f, f->head);
+		f->now_ns = pkt->ack_ns;
+		f->head++;
+		if (pkt->lost) {
+			f->loss_pending = true;
+			continue;
+		}
+		acked++;
+	} while (f->head != f->tail && acked < ack_every &&
+		 !sim_pkt(f, f->head)->lost);
+	if (!acked)
+		return true;
+
+	cubic_now_us = run_start_us + f->now_ns / 1000;
+	tp->tcp_mstamp = cubic_now_us;
+	f->delivered += acked;
+	f->delivered_ns = f->now_ns;
+	tp->delivered = f->delivered;
+	tp->rate_delivered = f->delivered - pkt->delivered;
+	tp->rate_interval_us = max_t(u64, (f->now_ns - pkt->delivered_ns) /
+				     1000, 1);
+	tp->snd_una = f->head;
+	tp->packets_out = f->tail - f->head;
+	if (!tp->srtt_us)
+		tp->srtt_us = (f->now_ns - pkt->sent_ns) / 1000 << 3;
+
+	flow_ack(tp, res, acked, (f->now_ns - pkt->sent_ns) / 1000);
+	if (f->dump)
+		fprintf(f->dump, "%llu %llu %u\n",
+			(unsigned long long)(f->now_ns - f->start_ns) / 1000,
+			(unsigned long long)(f->now_ns - pkt->sent_ns) / 1000,
+			acked);
+
+	if (after(f->head, f->round_end)) {
+		f->round++;
+		f->round_end = f->tail;
+	}
+
+	if (f->loss_pending) {
+		if (!res->exited || f->round <= res->exit_round + TAIL_ROUNDS)
+			res->tail_loss = true;
+		flow_loss(tp);
+		flow_check_exit(tp, res, f->round, true,
+				run_start_us + f->start_ns / 1000);
+		return false;
+	}
+	flow_check_exit(tp, res, f->round, false,
+			run_start_us + f->start_ns / 1000);
+
+	return !(res->exited && f->round > res->exit_round + TAIL_ROUNDS) &&
+	       f->round < max_rounds;
+}
+
+/*
+ * Closed-loop run of flows over link l until all are over, always
+ * stepping the flow whose next event is the earliest.
+ */
+static void sim_run(struct flow *flows, u32 nr, struct link *l,
+		    const struct profile *p, const struct mode *m,
+		    u32 ack_every, u32 max_rounds)
+{
+	for (;;) {
+		struct flow *f = NULL;
+		u32 i;
+
+		for (i = 0; i < nr; i++) {
+			if (flows[i].done)
+				continue;
+			if (!f || sim_next_ns(&flows[i]) < sim_next_ns(f))
+				f = &flows[i];
+		}
+		if (!f)
+			break;
+
+		if (!f->started) {
+			sim_start(f, l, m);
+		} else if (sim_pacing_wake(f)) {
+			f->now_ns = sim_next_ns(f);
+			f->paced = false;
+		} else if (!sim_ack(f, ack_every, max_rounds)) {
+			sim_stop(f);
+			continue;
+		}
+
+		sim_send(f, l, p);
+		if (!f->paced && f->head == f->tail)
+			sim_stop(f);
+	}
+}
+
+static void summary_add(struct summary *s, const struct result *res,
+			u32 bdp)
+{
+	int trig = 7;
+
+	s->flows++;
+	s->acks += res->acks;
+	s->cc_ns += res->cc_ns;
+	if (res->tail_loss)
+		s->losses++;
+
+	if (!res->exited) {
+		s->trig[trig]++;
+		return;
+	}
+	if (res->found & HYSTART_ACK_TRAIN)
+		trig = 0;
+	else if (res->found & HYSTART_DELAY)
+		trig = 1;
+	else if (res->found & HYSTART_DELAY_SDEV)
+		trig = 2;
+	else if (res->found & HYSTART_RATE)
+		trig = 3;
+	else if (res->found & HYSTART_CUSTOM)
+		trig = 4;
+	else if (res->found & HYSTART_SHARED)
+		trig = 5;
+	else
+		trig = 6;
+	s->trig[trig]++;
+
+	s->exit_cwnd += res->exit_cwnd;
+	s->exit_round += res->exit_round;
+	s->exit_ms += res->exit_us / 1000.0;
+	if (bdp)
+		s->overshoot += 100.0 * res->exit_cwnd / bdp;
+}
+
+static void summary_header(void)
+{
+	printf("%-14s %-8s %5s %9s %6s %9s %9s %5s %-19s %7s\n",
+	       "mode", "profile", "flows", "exit_cwnd", "round", "exit_ms",
+	       "overshoot", "loss", "trig T/D/S/R/C/H/L/N", "ns/ack");
+}
+
+static void summary_print(const struct summary *s, const char *mode,
+			  const char *profile, u32 bdp)
+{
+	u32 exited = s->flows - s->trig[7];
+	char trig[32], over[16];
+
+	snprintf(trig, sizeof(trig), "%u/%u/%u/%u/%u/%u/%u/%u", s->trig[0],
+		 s->trig[1], s->trig[2], s->trig[3], s->trig[4], s->trig[5],
+		 s->trig[6], s->trig[7]);
+	if (bdp && exited)
+		snprintf(over, sizeof(over), "%.0f%%", s->overshoot / exited);
+	else
+		snprintf(over, sizeof(over), "-");
+
+	exited = max(exited, 1U);
+	printf("%-14s %-8s %5u %9.0f %6.1f %9.1f %9s %4.0f%% %-19s %7.1f\n",
+	       mode, profile, s->flows, s->exit_cwnd / exited,
+	       s->exit_round / exited, s->exit_ms / exited, over,
+	       100.0 * s->losses / s->flows, trig,
+	       s->acks ? (double)s->cc_ns / s->acks : 0.0);
+}
+
+/* -c: the exit cause at least half the flows of each run must show and
+ * the band their mean exit cwnd must fall in, in percent of the BDP
+ */
+static struct check {
+	int	trig;		/* index into summary.trig, -1 for none */
+	u32	lo;
+	u32	hi;
+} check = { .trig = -1 };
+
+static const char trig_names[] = "TDSRCHLN";
+
+static bool summary_check(const struct summary *s, const char *mode,
+			  const char *profile, u32 bdp)
+{
+	u32 exited = s->flows - s->trig[7];
+	double over;
+
+	if (check.trig < 0)
+		return true;
+	if (s->trig[check.trig] * 2 < s->flows) {
+		fprintf(stderr, "FAIL %s %s: %u of %u flows exited by %c\n",
+			mode, profile, s->trig[check.trig], s->flows,
+			trig_names[check.trig]);
+		return false;
+	}
+	if (!check.hi)
+		return true;
+	over = bdp && exited ? s->overshoot / exited : 0;
+	if (over < check.lo || over > check.hi) {
+		fprintf(stderr, "FAIL %s %s: exit cwnd %.0f%% of the BDP,"
+			" not %u..%u%%\n", mode, profile, over, check.lo,
+			check.hi);
+		return false;
+	}
+	return true;
+}
+
+static bool run_sim(const struct mode *m, const struct profile *p,
+		    u32 nr, u64 seed, u32 ack_every, u32 max_rounds,
+		    u32 gap_ms, FILE *dump)
+{
+	struct link l = {
+		.tx_ns	= (u64)MSS_WIRE_BITS * 1000 / p->rate_mbps,
+	};
+	struct summary s = { 0 };
+	struct flow *flows;
+	u32 i;
+
+	l.bdp = DIV_ROUND_UP((u64)p->base_rtt_us * 1000, l.tx_ns);
+	l.buffer = max_t(u32, (u64)l.bdp * p->buffer_pct / 100,
+			 p->buffer_min);
+	flows = calloc(nr, sizeof(*flows));
+	if (!flows) {
+		perror("calloc");
+		exit(1);
+	}
+
+	params_apply(m);
+	for (i = 0; i < nr; i++) {
+		struct flow *f = &flows[i];
+
+		f->rng = seed + i * 0x9E3779B97F4A7C15ULL;
+		if (!f->rng)
+			f->rng = 1;
+		f->dump = i ? NULL : dump;
+		if (gap_ms)
+			f->start_ns = (u64)i * gap_ms * 1000000;
+	}
+
+	if (gap_ms) {
+		run_start_us = cubic_now_us + FLOW_GAP_US;
+		sim_run(flows, nr, &l, p, m, ack_every, max_rounds);
+	} else {
+		for (i = 0; i < nr; i++) {
+			run_start_us = cubic_now_us + FLOW_GAP_US;
+			l.free_ns = 0;
+			sim_run(&flows[i], 1, &l, p, m, ack_every,
+				max_rounds);
+		}
+	}
+
+	for (i = 0; i < nr; i++)
+		summary_add(&s, &flows[i].res, l.bdp);
+	free(flows);
+	summary_print(&s, m->name, p->name, l.bdp);
+	return summary_check(&s, m->name, p->name, l.bdp);
+}
+
+struct trace_ack {
+	u64	t_us;
+	u32	rtt_us;
+	u32	acked;
+};
+
+static struct trace_ack *trace_load(const char *path, u32 *nr)
+{
+	struct trace_ack *acks = NULL;
+	u32 n = 0, alloc = 0;
+	char line[256];
+	FILE *f;
+
+	f = strcmp(path, "-") ? fopen(path, "r") : stdin;
+	if (!f) {
+		perror(path);
+		exit(1);
+	}
+	while (fgets(line, sizeof(line), f)) {
+		unsigned long long t;
+		unsigned int rtt, acked = 1;
+
+		if (line[0] == '#' ||
+		    sscanf(line, "%llu %u %u", &t, &rtt, &acked) < 2)
+			continue;
+		if (n == alloc) {
+			alloc = alloc ? 2 * alloc : 4096;
+			acks = realloc(acks, alloc * sizeof(*acks));
+			if (!acks) {
+				perror("realloc");
+				exit(1);
+			}
+		}
+		acks[n].t_us = t;
+		acks[n].rtt_us = rtt;
+		acks[n].acked = max(acked, 1U);
+		n++;
+	}
+	if (f != stdin)
+		fclose(f);
+	*nr = n;
+	return acks;
+}
+
+/*
+ * Open-loop replay: the trace decides the ACK times and RTTs, the flow
+ * only decides cwnd.  The delivery rate is what the trace delivered over
+ * the last RTT.
+ */
+static bool run_trace(const struct mode *m, const struct trace_ack *acks,
+		      u32 nr, u32 bdp, const char *name)
+{
+	struct summary s = { 0 };
+	u32 i, lo = 0, round = 0, round_end = 0, delivered = 0;
+	u32 *delivered_at;
+	struct tcp_sock tp;
+	struct result res;
+
+	delivered_at = malloc((nr + 1) * sizeof(*delivered_at));
+	if (!delivered_at) {
+		perror("malloc");
+		exit(1);
+	}
+
+	params_apply(m);
+	memset(&res, 0, sizeof(res));
+	cubic_now_us = acks[0].t_us;
+	flow_init(&tp, m, htonl(0x0a000001));
+	tp.snd_nxt = tp.snd_cwnd;
+
+	for (i = 0; i < nr; i++) {
+		const struct trace_ack *a = &acks[i];
+
+		cubic_now_us = a->t_us;
+		tp.tcp_mstamp = a->t_us;
+		delivered += a->acked;
+		delivered_at[i] = delivered;
+		while (lo < i && acks[lo].t_us + a->rtt_us <= a->t_us)
+			lo++;
+		tp.delivered = delivered;
+		tp.rate_delivered = delivered - (lo ? delivered_at[lo - 1] : 0);
+		tp.rate_interval_us = max_t(u64, a->t_us -
+					    (lo ? acks[lo - 1].t_us : 0), 1);
+		tp.snd_una += a->acked;
+		tp.packets_out = tp.snd_nxt - tp.snd_una;
+		if (!tp.srtt_us)
+			tp.srtt_us = a->rtt_us << 3;
+
+		flow_ack(&tp, &res, a->acked, a->rtt_us);
+		tp.snd_nxt = tp.snd_una + tp.snd_cwnd;
+
+		if (after(tp.snd_una, round_end)) {
+			round++;
+			round_end = tp.snd_nxt;
+		}
+		flow_check_exit(&tp, &res, round, false, 0);
+	}
+
+	flow_release(&tp);
+	free(delivered_at);
+	summary_add(&s, &res, bdp);
+	summary_print(&s, m->name, name, bdp);
+	return summary_check(&s, m->name, name, bdp);
+}
+
+static void usage(void)
+{
+	unsigned int i;
+
+	fprintf(stderr,
+		"usage: cubic_replay [-m mode,..] [-p profile,..] [-n flows]"
+		" [-s seed] [-a acks]\n"
+		"                    [-r rounds] [-g gap_ms]"
+		" [-o param=value]...\n"
+		"                    [-d dump]"
+		" [-P detect,low_window,ack_delta_ms,delay_max_ms]\n"
+		"                    [-c trig[,lo,hi]]\n"
+		"       cubic_replay -f trace [-b bdp] [-m mode,..]"
+		" [-o param=value]...\n"
+		"                    [-c trig[,lo,hi]]\n\nmodes:");
+	for (i = 0; i < ARRAY_SIZE(modes); i++)
+		fprintf(stderr, " %s", modes[i].name);
+	fprintf(stderr, "\nprofiles:");
+	for (i = 0; i < ARRAY_SIZE(profiles); i++)
+		fprintf(stderr, " %s", profiles[i].name);
+	fprintf(stderr, "\nparams:");
+	for (i = 0; i < ARRAY_SIZE(params); i++)
+		fprintf(stderr, " %s", params[i].name);
+	fprintf(stderr, "\n");
+	exit(2);
+}
+
+/* -P: the fields of struct tcp_cubic_hystart, range checked like tcp.c */
+static int parse_policy(const char *arg)
+{
+	unsigned int detect, low_window, ack_delta, delay_max;
+
+	if (sscanf(arg, "%i,%u,%u,%u", &detect, &low_window, &ack_delta,
+		   &delay_max) != 4 ||
+	    (detect & ~TCP_CUBIC_HYSTART_DETECT) || low_window > U8_MAX ||
+	    ack_delta > U8_MAX || delay_max > U8_MAX)
+		return -EINVAL;
+
+	flow_policy.set = 1;
+	flow_policy.detect = detect;
+	flow_policy.low_window = low_window;
+	flow_policy.ack_delta_ms = ack_delta;
+	flow_policy.delay_max_ms = delay_max;
+	return 0;
+}
+
+/* -c: one of trig_names, optionally with the band of the exit cwnd */
+static int parse_check(const char *arg)
+{
+	const char *t = arg[0] ? strchr(trig_names, arg[0]) : NULL;
+
+	if (!t)
+		return -EINVAL;
+	check.trig = t - trig_names;
+	if (!arg[1])
+		return 0;
+	if (sscanf(arg + 1, ",%u,%u", &check.lo, &check.hi) != 2 ||
+	    check.lo > check.hi || !check.hi)
+		return -EINVAL;
+	return 0;
+}
+
+/* Turn a comma separated list of names into a bitmap over table */
+static u32 parse_list(char *list, const void *table, size_t size, u32 nr)
+{
+	u32 mask = 0, i;
+	char *name;
+
+	for (name = strtok(list, ","); name; name = strtok(NULL, ",")) {
+		for (i = 0; i < nr; i++) {
+			if (!strcmp(*(const char * const *)
+				    ((const char *)table + i * size), name))
+				break;
+		}
+		if (i == nr) {
+			fprintf(stderr, "unknown name '%s'\n", name);
+			usage();
+		}
+		mask |= 1U << i;
+	}
+	return mask;
+}
+
+int main(int argc, char **argv)
+{
+	u32 mode_mask = ~0U, profile_mask = ~0U;
+	u32 flows = 20, ack_every = 1, max_rounds = DEFAULT_ROUNDS, bdp = 0;
+	u32 gap_ms = 0;
+	const char *trace = NULL;
+	FILE *dump = NULL;
+	bool ok = true;
+	u64 seed = 1;
+	unsigned int i, j;
+	int opt;
+
+	params_save();
+
+	while ((opt = getopt(argc, argv,
+			     "m:p:n:s:a:r:g:o:d:f:b:P:c:h")) != -1) {
+		switch (opt) {
+		case 'm':
+			mode_mask = parse_list(optarg, modes, sizeof(modes[0]),
+					       ARRAY_SIZE(modes));
+			break;
+		case 'p':
+			profile_mask = parse_list(optarg, profiles,
+						  sizeof(profiles[0]),
+						  ARRAY_SIZE(profiles));
+			break;
+		case 'n':
+			flows = max(strtoul(optarg, NULL, 0), 1UL);
+			break;
+		case 's':
+			seed = strtoull(optarg, NULL, 0);
+			break;
+		case 'a':
+			ack_every = max(strtoul(optarg, NULL, 0), 1UL);
+			break;
+		case 'r':
+			max_rounds = strtoul(optarg, NULL, 0);
+			break;
+		case 'g':
+			gap_ms = strtoul(optarg, NULL, 0);
+			break;
+		case 'o':
+			if (param_override(optarg)) {
+				fprintf(stderr, "bad parameter '%s'\n", optarg);
+				usage();
+			}
+			break;
+		case 'P':
+			if (parse_policy(optarg)) {
+				fprintf(stderr, "bad policy '%s'\n", optarg);
+				usage();
+			}
+			break;
+		case 'c':
+			if (parse_check(optarg)) {
+				fprintf(stderr, "bad check '%s'\n", optarg);
+				usage();
+			}
+			break;
+		case 'd':
+			dump = fopen(optarg, "w");
+			if (!dump) {
+				perror(optarg);
+				return 1;
+			}
+			break;
+		case 'f':
+			trace = optarg;
+			break;
+		case 'b':
+			bdp = strtoul(optarg, NULL, 0);
+			break;
+		default:
+			usage();
+		}
+	}
+	if (optind != argc)
+		usage();
+
+	clock_calibrate();
+	summary_header();
+
+	if (trace) {
+		struct trace_ack *acks;
+		u32 nr;
+
+		acks = trace_load(trace, &nr);
+		if (!nr) {
+			fprintf(stderr, "%s: no ACKs\n", trace);
+			return 1;
+		}
+		for (i = 0; i < ARRAY_SIZE(modes); i++)
+			if (mode_mask & (1U << i))
+				ok &= run_trace(&modes[i], acks, nr, bdp,
+						"trace");
+		free(acks);
+		return !ok;
+	}
+
+	for (j = 0; j < ARRAY_SIZE(profiles); j++) {
+		if (!(profile_mask & (1U << j)))
+			continue;
+		for (i = 0; i < ARRAY_SIZE(modes); i++) {
+			if (!(mode_mask & (1U << i)))
+				continue;
+			ok &= run_sim(&modes[i], &profiles[j], flows, seed,
+				      ack_every, max_rounds, gap_ms, dump);
+			if (dump) {
+				fclose(dump);
+				dump = NULL;
+			}
+		}
+	}
+	return !ok;
+}
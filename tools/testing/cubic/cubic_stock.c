@@ -0,0 +1,13 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * stock/tcp_cubic.c is net/ipv4/tcp_cubic.c of 4.15, unchanged, and
+ * cubic_bench's reference.  It builds on its own here, against the same
+ * shims as the module under test but out of its namespace.
+ */
+#include "stock/tcp_cubic.c"
+
+struct tcp_congestion_ops *cubic_stock_ops(void)
+{
+	cubictcp_register();
+	return &cubictcp;
+}
@@ -0,0 +1,12 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#ifndef _CUBIC_SHIM_HASH_H
+#define _CUBIC_SHIM_HASH_H
+
+#include <linux/kernel.h>
+
+static inline u32 hash_32(u32 val, unsigned int bits)
+{
+	return (val * 0x61C88647U) >> (32 - bits);
+}
+
+#endif
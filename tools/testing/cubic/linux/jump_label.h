@@ -0,0 +1,17 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#ifndef _CUBIC_SHIM_JUMP_LABEL_H
+#define _CUBIC_SHIM_JUMP_LABEL_H
+
+#include <stdbool.h>
+
+/* Static keys as plain flags: one load and branch instead of a nop */
+struct static_key_false {
+	bool	enabled;
+};
+
+#define DEFINE_STATIC_KEY_FALSE(name)	struct static_key_false name
+#define static_branch_unlikely(k)	__builtin_expect((k)->enabled, 0)
+#define static_branch_enable(k)		((k)->enabled = true)
+#define static_branch_disable(k)	((k)->enabled = false)
+
+#endif
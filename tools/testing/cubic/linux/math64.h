@@ -0,0 +1,28 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#ifndef _CUBIC_SHIM_MATH64_H
+#define _CUBIC_SHIM_MATH64_H
+
+#include <linux/kernel.h>
+
+static inline u64 div64_u64(u64 a, u64 b)
+{
+	return a / b;
+}
+
+static inline u64 div_u64(u64 a, u32 b)
+{
+	return a / b;
+}
+
+static inline s64 div_s64(s64 a, s32 b)
+{
+	return a / b;
+}
+
+#define do_div(n, base) ({			\
+	u32 __rem = (n) % (base);		\
+	(n) /= (base);				\
+	__rem;					\
+})
+
+#endif
@@ -0,0 +1,17 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#ifndef _CUBIC_SHIM_MODULE_H
+#define _CUBIC_SHIM_MODULE_H
+
+#define THIS_MODULE		NULL
+#define module_param(n, t, p)
+#define MODULE_PARM_DESC(n, d)
+#define EXPORT_SYMBOL_GPL(x)
+#define MODULE_AUTHOR(x)
+#define MODULE_LICENSE(x)
+#define MODULE_ALIAS(x)
+#define MODULE_DESCRIPTION(x)
+#define MODULE_VERSION(x)
+#define module_init(f)
+#define module_exit(f)
+
+#endif
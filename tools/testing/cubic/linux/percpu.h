@@ -0,0 +1,12 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#ifndef _CUBIC_SHIM_PERCPU_H
+#define _CUBIC_SHIM_PERCPU_H
+
+/* The harness is single threaded: one CPU */
+#define DEFINE_PER_CPU(type, name)	type name
+#define this_cpu_inc(var)		((var)++)
+#define this_cpu_add(var, val)		((var) += (val))
+#define per_cpu(var, cpu)		(var)
+#define for_each_possible_cpu(cpu)	for ((cpu) = 0; (cpu) < 1; (cpu)++)
+
+#endif
@@ -0,0 +1,5 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#ifndef _CUBIC_SHIM_PROC_FS_H
+#define _CUBIC_SHIM_PROC_FS_H
+/* No CONFIG_PROC_FS: tcp_cubic.c stubs out /proc/net/tcp_cubic */
+#endif
@@ -0,0 +1,13 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#ifndef _CUBIC_SHIM_SLAB_H
+#define _CUBIC_SHIM_SLAB_H
+
+#include <stdlib.h>
+
+#define GFP_ATOMIC	0
+#define GFP_KERNEL	0
+#define kmalloc(size, gfp)	malloc(size)
+#define kzalloc(size, gfp)	calloc(1, size)
+#define kfree(p)		free(p)
+
+#endif
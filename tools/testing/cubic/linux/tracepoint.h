@@ -0,0 +1,49 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#ifndef _CUBIC_SHIM_TRACEPOINT_H
+#define _CUBIC_SHIM_TRACEPOINT_H
+
+/*
+ * Events fill a global record instead of a ring buffer, so that turning
+ * them on costs what the TP_fast_assign() blocks cost and the stores are
+ * not optimised away.
+ */
+extern bool cubic_trace_enabled;
+
+#define PARAMS(args...)			args
+#define TP_PROTO(args...)		args
+#define TP_ARGS(args...)		args
+#define TP_STRUCT__entry(args...)	args
+#define TP_fast_assign(args...)		args
+#define TP_printk(fmt, args...)		fmt
+#define __field(t, n)			t n;
+#define __print_flags(f, d, v...)	""
+#define __print_symbolic(v, s...)	""
+
+#define DECLARE_EVENT_CLASS(name, proto, args, tstruct, assign, print)	\
+	struct trace_event_raw_##name { tstruct };			\
+	struct trace_event_raw_##name trace_record_##name;		\
+	static inline void trace_class_##name(proto)			\
+	{								\
+		struct trace_event_raw_##name *__entry =		\
+			&trace_record_##name;				\
+		assign;							\
+	}
+
+#define DEFINE_EVENT(cls, name, proto, args)				\
+	static inline bool trace_##name##_enabled(void)			\
+	{								\
+		return unlikely(cubic_trace_enabled);			\
+	}								\
+	static inline void trace_##name(proto)				\
+	{								\
+		if (unlikely(cubic_trace_enabled))			\
+			trace_class_##cls(args);			\
+	}
+
+#define TRACE_EVENT(name, proto, args, tstruct, assign, print)		\
+	DECLARE_EVENT_CLASS(name, PARAMS(proto), PARAMS(args),		\
+			    PARAMS(tstruct), PARAMS(assign),		\
+			    PARAMS(print))				\
+	DEFINE_EVENT(name, name, PARAMS(proto), PARAMS(args))
+
+#endif
@@ -0,0 +1,27 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#ifndef _CUBIC_SHIM_INETPEER_H
+#define _CUBIC_SHIM_INETPEER_H
+
+#include <linux/kernel.h>
+
+struct inetpeer_addr {
+	union {
+		__be32		a4;
+		u32		key[4];
+	};
+	__u16	family;
+};
+
+static inline void inetpeer_set_addr_v4(struct inetpeer_addr *iaddr, __be32 ip)
+{
+	iaddr->a4 = ip;
+	iaddr->family = AF_INET;
+}
+
+static inline int inetpeer_addr_cmp(const struct inetpeer_addr *a,
+				    const struct inetpeer_addr *b)
+{
+	return a->family != b->family || a->a4 != b->a4;
+}
+
+#endif
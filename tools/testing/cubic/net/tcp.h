@@ -0,0 +1,325 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#ifndef _CUBIC_SHIM_TCP_H
+#define _CUBIC_SHIM_TCP_H
+
+/*
+ * Just enough of struct sock / tcp_sock and the congestion control glue
+ * for net/ipv4/tcp_cubic.c to build and run in userspace.  Field names
+ * follow the kernel so the module source needs no changes; layout does
+ * not, except that the private CA area is ICSK_CA_PRIV_SIZE bytes.
+ */
+#include <linux/kernel.h>
+#include <linux/welford.h>
+#include <linux/slab.h>
+#include <net/inetpeer.h>
+#include <uapi/linux/tcp_cubic.h>
+
+struct rcu_head { };
+
+#define __rcu
+#define rcu_dereference(p)		(p)
+#define rcu_dereference_protected(p, c)	(p)
+#define rcu_assign_pointer(p, v)	((p) = (v))
+#define RCU_INIT_POINTER(p, v)		((p) = (v))
+#define rcu_read_lock()			do { } while (0)
+#define rcu_read_unlock()		do { } while (0)
+#define synchronize_rcu()		do { } while (0)
+#define kfree_rcu(p, f)			kfree(p)
+#define lockdep_is_held(l)		1
+typedef int spinlock_t;
+#define DEFINE_SPINLOCK(l)		spinlock_t l
+#define spin_lock_init(l)		(*(l) = 0)
+#define spin_lock_bh(l)			((void)(l))
+#define spin_unlock_bh(l)		((void)(l))
+#define time_before(a, b)		((long)((a) - (b)) < 0)
+
+#define HZ			1000
+#define ICSK_CA_PRIV_SIZE	(11 * sizeof(u64))
+#define TCP_INFINITE_SSTHRESH	0x7fffffff
+#define GSO_MAX_SIZE		65536
+#define TCP_CA_NAME_MAX		16
+#define INET_DIAG_VEGASINFO	3
+
+enum tcp_ca_event {
+	CA_EVENT_TX_START,
+	CA_EVENT_CWND_RESTART,
+	CA_EVENT_COMPLETE_CWR,
+	CA_EVENT_LOSS,
+	CA_EVENT_ECN_NO_CE,
+	CA_EVENT_ECN_IS_CE,
+	CA_EVENT_DELAYED_ACK,
+	CA_EVENT_NON_DELAYED_ACK,
+};
+
+enum tcp_ca_state {
+	TCP_CA_Open,
+	TCP_CA_Disorder,
+	TCP_CA_CWR,
+	TCP_CA_Recovery,
+	TCP_CA_Loss,
+};
+
+enum {
+	SOCK_DBG = 1,
+};
+
+enum {
+	LINUX_MIB_TCPHYSTARTTRAINDETECT,
+	LINUX_MIB_TCPHYSTARTTRAINCWND,
+	LINUX_MIB_TCPHYSTARTDELAYDETECT,
+	LINUX_MIB_TCPHYSTARTDELAYCWND,
+	__LINUX_MIB_MAX
+};
+
+struct net {
+	u64	mib[__LINUX_MIB_MAX];
+	void	*proc_net;
+};
+
+extern struct net init_net;
+
+typedef struct {
+	struct net *net;
+} possible_net_t;
+
+static inline struct net *read_pnet(const possible_net_t *pnet)
+{
+	return pnet->net;
+}
+
+static inline void write_pnet(possible_net_t *pnet, struct net *net)
+{
+	pnet->net = net;
+}
+
+static inline bool net_eq(const struct net *a, const struct net *b)
+{
+	return a == b;
+}
+
+static inline u32 net_hash_mix(const struct net *net)
+{
+	return (u32)(uintptr_t)net;
+}
+
+struct inet_sock {
+	__be16	inet_sport;
+	__be16	inet_dport;
+	__be32	inet_saddr;
+	__be32	inet_daddr;
+};
+
+struct inet_connection_sock {
+	struct inet_sock		icsk_inet;
+	const struct tcp_congestion_ops	*icsk_ca_ops;
+	u8				icsk_ca_state;
+	u64				icsk_ca_priv[ICSK_CA_PRIV_SIZE /
+						     sizeof(u64)];
+};
+
+enum sk_pacing {
+	SK_PACING_NONE		= 0,
+	SK_PACING_NEEDED	= 1,
+	SK_PACING_FQ		= 2,
+};
+
+struct sock {
+	struct net	*net;
+	unsigned short	sk_family;
+	unsigned long	sk_flags;
+	u32		sk_pacing_rate;
+	u32		sk_max_pacing_rate;
+	u32		sk_pacing_status;	/* see enum sk_pacing */
+};
+
+struct tcp_cubic_policy {
+	u8	set:1,
+		detect:7;
+	u8	low_window;
+	u8	ack_delta_ms;
+	u8	delay_max_ms;
+};
+
+struct tcp_sock {
+	struct sock			sk;
+	struct inet_connection_sock	inet_conn;
+	u64	tcp_mstamp;
+	struct welford sdev_stats;
+	u32	srtt_us;
+	u32	mdev_us;
+	u32	snd_nxt;
+	u32	snd_una;
+	u32	pushed_seq;
+	u32	snd_cwnd;
+	u32	snd_ssthresh;
+	u32	snd_cwnd_cnt;
+	u32	snd_cwnd_clamp;
+	u32	prior_cwnd;
+	u32	lost_out;
+	u32	retrans_out;
+	u32	sacked_out;
+	u32	packets_out;
+	u32	delivered;
+	u32	rate_delivered;
+	u32	rate_interval_us;
+	u32	pacing_cap;
+	struct tcp_cubic_policy cubic_hystart;
+	u8	cubic_found;
+	u32	lsndtime;
+	u32	mss_cache;
+	u64	bytes_acked;
+	u8	rate_app_limited:1,
+		is_cwnd_limited:1,
+		sdev_frozen:1,
+		sdev_ewma_shift:5;
+	u8	rtt_samples:1;
+};
+
+struct ack_sample {
+	u32	pkts_acked;
+	s32	rtt_us;
+	u32	in_flight;
+};
+
+struct rate_sample;
+
+struct tcpvegas_info {
+	__u32	tcpv_enabled;
+	__u32	tcpv_rttcnt;
+	__u32	tcpv_rtt;
+	__u32	tcpv_minrtt;
+};
+
+struct tcp_bbr_info {
+	__u32	bbr_bw_lo;
+	__u32	bbr_bw_hi;
+	__u32	bbr_min_rtt;
+	__u32	bbr_pacing_gain;
+	__u32	bbr_cwnd_gain;
+};
+
+union tcp_cc_info {
+	struct tcpvegas_info	vegas;
+	struct tcp_bbr_info	bbr;
+};
+
+struct tcp_congestion_ops {
+	void (*init)(struct sock *sk);
+	void (*release)(struct sock *sk);
+	u32 (*ssthresh)(struct sock *sk);
+	void (*cong_avoid)(struct sock *sk, u32 ack, u32 acked);
+	void (*set_state)(struct sock *sk, u8 new_state);
+	void (*cwnd_event)(struct sock *sk, enum tcp_ca_event ev);
+	u32 (*undo_cwnd)(struct sock *sk);
+	void (*pkts_acked)(struct sock *sk, const struct ack_sample *sample);
+	size_t (*get_info)(struct sock *sk, u32 ext, int *attr,
+			   union tcp_cc_info *info);
+	void		*owner;
+	char		name[TCP_CA_NAME_MAX];
+	u32		flags;
+};
+
+/* The harness clock: usec of simulated time, jiffies are msec */
+extern u64 cubic_now_us;
+#define jiffies			((unsigned long)(cubic_now_us / USEC_PER_MSEC))
+#define tcp_jiffies32		((u32)jiffies)
+#define jiffies_to_msecs(j)	(j)
+#define msecs_to_jiffies(m)	(m)
+#define usecs_to_jiffies(u)	((u) / USEC_PER_MSEC)
+#define jiffies_to_usecs(j)	((j) * USEC_PER_MSEC)
+
+static inline struct tcp_sock *tcp_sk(const struct sock *sk)
+{
+	return (struct tcp_sock *)sk;
+}
+
+static inline struct inet_connection_sock *inet_csk(const struct sock *sk)
+{
+	return &tcp_sk(sk)->inet_conn;
+}
+
+static inline struct inet_sock *inet_sk(const struct sock *sk)
+{
+	return &inet_csk(sk)->icsk_inet;
+}
+
+static inline void *inet_csk_ca(const struct sock *sk)
+{
+	return inet_csk(sk)->icsk_ca_priv;
+}
+
+static inline struct net *sock_net(const struct sock *sk)
+{
+	return sk->net;
+}
+
+static inline bool sock_flag(const struct sock *sk, int flag)
+{
+	return sk->sk_flags & (1UL << flag);
+}
+
+#define NET_INC_STATS(net, field)	((net)->mib[field]++)
+#define NET_ADD_STATS(net, field, val)	((net)->mib[field] += (val))
+
+static inline bool before(__u32 seq1, __u32 seq2)
+{
+	return (__s32)(seq1 - seq2) < 0;
+}
+#define after(seq2, seq1)	before(seq1, seq2)
+
+static inline bool tcp_in_slow_start(const struct tcp_sock *tp)
+{
+	return tp->snd_cwnd < tp->snd_ssthresh;
+}
+
+/* The harness only ever sends a full window */
+static inline bool tcp_is_cwnd_limited(const struct sock *sk)
+{
+	return true;
+}
+
+/* From net/ipv4/tcp_cong.c */
+static inline u32 tcp_slow_start(struct tcp_sock *tp, u32 acked)
+{
+	u32 cwnd = min(tp->snd_cwnd + acked, tp->snd_ssthresh);
+
+	acked -= cwnd - tp->snd_cwnd;
+	tp->snd_cwnd = min(cwnd, tp->snd_cwnd_clamp);
+
+	return acked;
+}
+
+static inline void tcp_cong_avoid_ai(struct tcp_sock *tp, u32 w, u32 acked)
+{
+	if (tp->snd_cwnd_cnt >= w) {
+		tp->snd_cwnd_cnt = 0;
+		tp->snd_cwnd++;
+	}
+
+	tp->snd_cwnd_cnt += acked;
+	if (tp->snd_cwnd_cnt >= w) {
+		u32 delta = tp->snd_cwnd_cnt / w;
+
+		tp->snd_cwnd_cnt -= delta * w;
+		tp->snd_cwnd += delta;
+	}
+	tp->snd_cwnd = min(tp->snd_cwnd, tp->snd_cwnd_clamp);
+}
+
+static inline u32 tcp_reno_undo_cwnd(struct sock *sk)
+{
+	const struct tcp_sock *tp = tcp_sk(sk);
+
+	return max(tp->snd_cwnd, tp->prior_cwnd);
+}
+
+static inline int tcp_register_congestion_control(struct tcp_congestion_ops *ca)
+{
+	return 0;
+}
+
+static inline void tcp_unregister_congestion_control(struct tcp_congestion_ops *ca)
+{
+}
+
+#endif